@@ -0,0 +1,57 @@
+/*
+============================================
+ TODO Allocation Hooks
+============================================
+
+ Description:
+   Replaces the global operator new and
+   delete so heap use can be counted. Every
+   allocation calls countAllocation(size),
+   which the including file defines.
+   Include it in exactly one file of a
+   program: TaskList.cpp in allocation-
+   tracking builds, the benchmarks otherwise.
+
+============================================
+*/
+
+#ifndef TODO_ALLOCATION_HOOKS_H
+#define TODO_ALLOCATION_HOOKS_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// Defined by the file that includes this one
+static void countAllocation(std::size_t size);
+
+// The replacements stay out of line; once inlined, GCC pairs the malloc in
+// one with the free in another and warns about a mismatch
+#if defined(__GNUC__)
+#define TODO_NOINLINE __attribute__((noinline))
+#else
+#define TODO_NOINLINE
+#endif
+
+TODO_NOINLINE void* operator new(std::size_t size) {
+    countAllocation(size);
+    if (void* memory = std::malloc(size == 0 ? 1 : size)) return memory;
+    throw std::bad_alloc();
+}
+TODO_NOINLINE void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+TODO_NOINLINE void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+TODO_NOINLINE void operator delete[](void* memory) noexcept {
+    std::free(memory);
+}
+TODO_NOINLINE void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+TODO_NOINLINE void operator delete[](void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+#endif
@@ -11,24 +11,43 @@
      - Edit task descriptions
      - Toggle completion status
      - Delete tasks
+     - Search task descriptions
    All tasks are stored in a local text file
    for persistent storage across sessions.
 
  Author:  Eric Zimmer
  Created: June 14, 2025
  
- File Format:
-   tasks.txt stores each task in the format:
-   id|description|completed
-   Example:
-   1|Take out trash|0
-   2|Finish C++ project|1
+ Files:
+   CPPCLITODO.cpp  the menu and command line
+   TaskList.h/.cpp the task engine, which also
+                   describes the file formats
+   bench/          benchmarks for the engine
+
+   The tasks are kept in tasks.txt, with
+   changes since the last snapshot in
+   tasks.journal. How hard each save syncs
+   to disk is chosen with --durability
+   <none|data|full> (default full). Convert
+   tasks.txt between the text and binary
+   formats with:
+   ./todoapp --convert <text|binary> <input> <output>
 
  Compilation:
-   clang++ -std=c++17 -o todoapp CPPCLITODO.cpp
+   cmake -S . -B build && cmake --build build
+   or, without CMake:
+   clang++ -std=c++17 -pthread -o todoapp CPPCLITODO.cpp TaskList.cpp
 
  Usage:
-   ./todoapp
+   ./todoapp [--durability <none|data|full>]
+            [--commit-window <ms>] [--commit-records <n>]
+            [--page-size <n>] [--word-index] [--profile]
+            [--batch <ops file, or - for stdin>]
+
+   --profile times loading, saving, every
+   task operation and rendering, and prints
+   their latency percentiles with the
+   statistics and on exit.
 
  Requirements:
    - C++17 or higher
@@ -39,75 +58,142 @@
 
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <vector>
-#include <fstream>
-#include <sstream>
-
-class Task {
-private:
-    static int nextId;
-    int id;
-    std::string description;
-    bool completed;
-
-public:
-    // Constructor with initializer list
-    Task(const std::string& description)
-        : id(nextId++), description(description), completed(false) {}
-
-    // Getters
-    static int getNextId() {
-        return nextId;
-    }
-    int getId() const {
-        return id;
-    }
-    const std::string& getDescription() const {
-        return description;
-    }
-    bool isCompleted() const {
-        return completed;
-    }
-
-    // Setters
-    static void setNextId(int id) {
-        nextId = id;
-    }
-    void setId(int id) {
-        this->id = id;
-    }
-    void setDescription(const std::string& description) {
-        this->description = description;
-    }
-    void setCompleted(bool completed) {
-        this->completed = completed;
-    }
-};
+#include <limits>
+#include <charconv>
+#include <iomanip>
 
+#include "TaskList.h"
 
 /*
 ====== Function declarations ======
 */
 void printMenu();
 int getMenuInput();
-void addTask(std::vector<Task>& tasks);
-void viewTasks(const std::vector<Task>& tasks);
-void toggleTaskComplete(std::vector<Task>& tasks);
-void deleteTask(std::vector<Task>& tasks);
-void editTask(std::vector<Task>& tasks);
-void loadTasksFromFile(std::vector<Task>& tasks);
-void saveTasksToFile(const std::vector<Task>& tasks);
-
+void addTask(TaskList& list);
+void viewTasks(const TaskStore& tasks);
+void showStats(const TaskStore& tasks);
+void printLatencyReport(const LatencyProfile& latencies, std::ostream& out);
+#if TODO_TRACK_ALLOCATIONS
+void printAllocationReport(std::ostream& out);
+#endif
+void searchTasksMenu(TaskList& list);
+void renderTaskPreview(const TaskStore& tasks, std::string& out);
+void writeOutput(const std::string& out);
+void toggleTaskComplete(TaskList& list);
+void deleteTask(TaskList& list);
+void editTask(TaskList& list);
+int runBatch(TaskList& list, const std::string& path);
+void printUsage(const char* program);
+
+
+// Task listings are formatted here and written with one call.
+// It is reused so a long list does not reallocate on every view.
+std::string renderBuffer;
+
+// Listings show this many tasks at a time (set with --page-size)
+const size_t PAGE_SIZE = 20;
+size_t pageSize = PAGE_SIZE;
+
+// Exit keeps the number it always had, so scripts that pipe in menu
+// choices still end the session; newer options come after it
+const int MENU_EXIT = 6;
+
+// Rendering is timed into this while --profile is on (null when off)
+LatencyProfile* profile = nullptr;
+
+
+int main(int argc, char* argv[]) {
+    // Only iostreams are used, so cout can buffer on its own.
+    // cin stays tied to cout, so prompts still appear before each read.
+    std::ios::sync_with_stdio(false);
+
+    // Read command-line options
+    size_t commitWindowMs = GROUP_COMMIT_WINDOW.count();
+    size_t commitRecords = GROUP_COMMIT_RECORDS;
+    Durability durability = Durability::Full;
+    bool useWordIndex = false;
+    bool profiling = false;
+    std::string batchPath;
+    bool statsOnly = false;
+    for (int i = 1; i < argc; i++) {
+        std::string option = argv[i];
+        if (option == "--durability" && i + 1 < argc) {
+            if (!parseDurability(argv[++i], durability)) {
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (option == "--commit-window" && i + 1 < argc) {
+            if (!parseCount(argv[++i], commitWindowMs)) {
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (option == "--commit-records" && i + 1 < argc) {
+            if (!parseCount(argv[++i], commitRecords)) {
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (option == "--page-size" && i + 1 < argc) {
+            if (!parseCount(argv[++i], pageSize) || pageSize == 0) {
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (option == "--word-index") {
+            useWordIndex = true;
+        } else if (option == "--profile") {
+            profiling = true;
+        } else if (option == "--stats" && i + 1 == argc) {
+            statsOnly = true;
+        } else if (option == "--batch" && i + 2 == argc) {
+            batchPath = argv[++i];
+        } else if (option == "--convert" && i + 4 == argc) {
+            // Convert a snapshot between formats and exit
+            SnapshotFormat format;
+            if (!parseSnapshotFormat(argv[i + 1], format)) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            if (!convertSnapshot(format, argv[i + 2], argv[i + 3], durability)) {
+                std::cerr << "Could not convert " << argv[i + 2] << " to " << argv[i + 3] << "\n";
+                return 1;
+            }
+            return 0;
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
 
-// Tracks auto-increment id for tasks
-int Task::nextId = 1;
-const std::string TASKS_FILE = "tasks.txt";
+    // The tasks and the files behind them
+    TaskList list;
+    list.configure(durability, std::chrono::milliseconds(commitWindowMs), commitRecords);
+    list.setWordIndex(useWordIndex);
+    list.setProfiling(profiling);
+    profile = list.getProfile();
+    if (!list.load()) {
+        // Running on an empty list would write it over the damaged one
+        std::cerr << "Could not read tasks.txt: the snapshot is damaged. "
+                     "Restore it from a backup, or move it aside to start a new list.\n";
+        return 1;
+    }
 
+    // Print the statistics instead of showing the menu
+    if (statsOnly) {
+        showStats(list.getTasks());
+        return 0;
+    }
 
-int main() {
-    // Vector to store tasks
-    std::vector<Task> tasks;
-    loadTasksFromFile(tasks);
+    // Apply a batch of ops instead of showing the menu
+    if (!batchPath.empty()) {
+        int status = runBatch(list, batchPath);
+        if (!list.close()) status = 1;
+        if (profile) printLatencyReport(*profile, std::cerr);
+#if TODO_TRACK_ALLOCATIONS
+        printAllocationReport(std::cerr);
+#endif
+        return status;
+    }
 
     while (true) {
         // Get menu input
@@ -115,23 +201,41 @@ int main() {
         
         switch(menuInput) {
             case 1:
-                addTask(tasks);
+                addTask(list);
                 break;
             case 2:
-                viewTasks(tasks);
+                viewTasks(list.getTasks());
                 break;
             case 3:
-                toggleTaskComplete(tasks);
+                toggleTaskComplete(list);
                 break;
             case 4:
-                deleteTask(tasks);
+                deleteTask(list);
                 break;
             case 5:
-                editTask(tasks);
+                editTask(list);
+                break;
+            case MENU_EXIT: {
+                std::cout << "Exiting... \n";
+                // Commit the last group of records; changes after a failed
+                // journal write were only kept in memory
+                bool saved = list.close();
+                if (!saved) {
+                    std::cerr << "Could not write tasks.journal; "
+                                 "changes made since it failed were not saved\n";
+                }
+                if (profile) printLatencyReport(*profile, std::cerr);
+#if TODO_TRACK_ALLOCATIONS
+                printAllocationReport(std::cerr);
+#endif
+                return saved ? 0 : 1;
+            }
+            case 7:
+                showStats(list.getTasks());
+                break;
+            case 8:
+                searchTasksMenu(list);
                 break;
-            case 6:
-                std::cout << "Exiting... " << std::endl;
-                return 0;
         }
     }
 
@@ -143,26 +247,31 @@ void printMenu() {
     /*
     This function prints the menu.
     */
-    std::cout << "====== TODO MENU ======" << std::endl;
-    std::cout << "1. Add a task\n"
+    std::cout << "====== TODO MENU ======\n"
+    "1. Add a task\n"
     "2. View all tasks\n"
     "3. Toggle task as complete/incomplete\n"
     "4. Delete a task\n"
     "5. Edit a task description\n"
-    "6. Exit" << std::endl;
-    std::cout << "=======================\n";
+    "6. Exit\n"
+    "7. Show statistics\n"
+    "8. Search tasks\n"
+    "=======================\n";
 }
 
 
 int getMenuInput() {
     /*
     This function gets the input for the menu options and returns it.
+    The end of the input counts as choosing Exit.
     */
     while (true) {
         printMenu();
         int choice;
-        if (std::cin >> choice && choice >= 1 && choice <= 6) {
+        if (std::cin >> choice && choice >= 1 && choice <= 8) {
             return choice;
+        } else if (std::cin.eof()) {
+            return MENU_EXIT;
         } else {
             std::cin.clear();
             std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
@@ -172,26 +281,24 @@ int getMenuInput() {
 }
 
 
-void addTask(std::vector<Task>& tasks) {
+void addTask(TaskList& list) {
     /*
-    This function creates a new task object and adds it to the task vector.
+    This function asks for a description and adds a new task with it.
     */
     std::cin.ignore(); // Clear newline from previous input
     std:: string description;
     std::cout << "Enter task description: ";
     std::getline(std::cin, description); // Get input
 
-    Task newTask(description); // Create new task object
-    tasks.push_back(newTask); // Add new task to tasks vector
-
-    std::cout << "Task added.\n" << std::endl; // Confirm message
-    saveTasksToFile(tasks);
+    list.add(description); // Add new task to the list
+    std::cout << "Task added.\n\n"; // Confirm message
 }
 
 
-void viewTasks(const std::vector<Task>& tasks) {
+void viewTasks(const TaskStore& tasks) {
     /*
-    This function prints all of the tasks from the tasks vector.
+    This function prints the tasks one page at a time. Only the visible
+    page is formatted, so paging costs the same on any size of list.
     */
    // Check if there are tasks.
     if (tasks.empty()) {
@@ -199,34 +306,253 @@ void viewTasks(const std::vector<Task>& tasks) {
         return;
     }
 
-    // Print the tasks from tasks vector
-    std::cout << "\n====== TASK LIST ======\n";
-    for (const Task& task : tasks) {
-        std::cout << "[" << (task.isCompleted() ? "x" : " ") << "] "
-                  << task.getId() << ": " << task.getDescription() << "\n";
+    TaskStore::const_iterator first = tasks.begin();
+    size_t position = 0; // How many tasks come before first
+    while (true) {
+        // Format the visible page and print it in one write
+        renderBuffer.clear();
+        renderBuffer += "\n====== TASK LIST ======\n";
+        TaskStore::const_iterator last = first;
+        size_t shown;
+        {
+            OperationScope scope(profile, Operation::Render);
+            shown = renderTaskWindow(last, tasks.end(), pageSize, renderBuffer);
+        }
+        renderBuffer += "=======================\n";
+
+        // The whole list fits on one page
+        if (tasks.size() <= pageSize) {
+            renderBuffer += '\n';
+            writeOutput(renderBuffer);
+            return;
+        }
+
+        char digits[16];
+        renderBuffer += "Tasks ";
+        renderBuffer.append(digits, std::to_chars(digits, digits + sizeof(digits), position + 1).ptr);
+        renderBuffer += '-';
+        renderBuffer.append(digits, std::to_chars(digits, digits + sizeof(digits), position + shown).ptr);
+        renderBuffer += " of ";
+        renderBuffer.append(digits, std::to_chars(digits, digits + sizeof(digits), tasks.size()).ptr);
+        renderBuffer += ". [n]ext, [p]revious, [g]o to ID, [q]uit: ";
+        writeOutput(renderBuffer);
+
+        // Get the pager command
+        std::string command;
+        if (!(std::cin >> command) || command == "q") {
+            std::cout << "\n";
+            return;
+        }
+
+        if (command == "n") {
+            if (last != tasks.end()) {
+                first = last;
+                position += shown;
+            }
+        } else if (command == "p") {
+            for (size_t i = 0; i < pageSize && first != tasks.begin(); i++) {
+                --first;
+                position--;
+            }
+        } else if (command == "g") {
+            int id;
+            std::cout << "Enter the ID to jump to: ";
+            if (!(std::cin >> id)) {
+                std::cin.clear();
+                std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+                std::cout << "Invalid input.\n";
+                continue;
+            }
+            TaskStore::const_iterator target = tasks.findPosition(id);
+            if (target == tasks.end()) {
+                std::cout << "Task with ID " << id << " not found.\n";
+                continue;
+            }
+            // The page starts at the task; count how many come before it
+            first = target;
+            position = 0;
+            for (TaskStore::const_iterator it = tasks.begin(); it != first; ++it) position++;
+        } else {
+            std::cout << "Invalid input. Try again.\n";
+        }
+    }
+}
+
+
+void renderTaskPreview(const TaskStore& tasks, std::string& out) {
+    /*
+    This function appends the first page of tasks for a selection prompt,
+    followed by how many more there are.
+    */
+    OperationScope scope(profile, Operation::Render);
+    out += "\nCurrent tasks:\n";
+    TaskStore::const_iterator it = tasks.begin();
+    size_t shown = renderTaskWindow(it, tasks.end(), pageSize, out);
+    if (shown < tasks.size()) {
+        char digits[16];
+        out += "... and ";
+        out.append(digits, std::to_chars(digits, digits + sizeof(digits), tasks.size() - shown).ptr);
+        out += " more (see View all tasks)\n";
+    }
+}
+
+
+void writeOutput(const std::string& out) {
+    /*
+    This function writes formatted output to std::cout in one call.
+    */
+    std::cout.write(out.data(), out.size());
+}
+
+
+void showStats(const TaskStore& tasks) {
+    /*
+    This function prints how many tasks there are, done and open.
+    The done count comes from the completed bits, not from the tasks.
+    */
+    size_t total = tasks.size();
+    size_t done = tasks.countCompleted();
+    std::cout << "\n====== STATISTICS ======\n"
+              << "Total: " << total << "\n"
+              << "Done:  " << done << "\n"
+              << "Open:  " << total - done << "\n"
+              << "========================\n\n";
+    if (profile) printLatencyReport(*profile, std::cout);
+#if TODO_TRACK_ALLOCATIONS
+    printAllocationReport(std::cout);
+#endif
+}
+
+
+void printLatencyReport(const LatencyProfile& latencies, std::ostream& out) {
+    /*
+    This function prints how many times each operation ran and its
+    latency percentiles, in microseconds. Operations that never ran
+    are left out.
+    */
+    std::ios::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << "======================= LATENCY (us) =======================\n"
+        << std::left << std::setw(10) << "Operation" << std::right
+        << std::setw(10) << "Count" << std::setw(10) << "p50" << std::setw(10) << "p99"
+        << std::setw(10) << "p999" << std::setw(10) << "Max" << "\n";
+    out << std::fixed << std::setprecision(1);
+    for (size_t i = 0; i < static_cast<size_t>(Operation::Count); i++) {
+        Operation operation = static_cast<Operation>(i);
+        const LatencyHistogram& histogram = latencies.get(operation);
+        if (histogram.getCount() == 0) continue;
+        out << std::left << std::setw(10) << operationName(operation) << std::right
+            << std::setw(10) << histogram.getCount()
+            << std::setw(10) << histogram.valueAtPercentile(50) / 1000.0
+            << std::setw(10) << histogram.valueAtPercentile(99) / 1000.0
+            << std::setw(10) << histogram.valueAtPercentile(99.9) / 1000.0
+            << std::setw(10) << histogram.getMax() / 1000.0 << "\n";
+    }
+    out << "============================================================\n\n";
+    out.flags(flags);
+    out.precision(precision);
+}
+
+
+#if TODO_TRACK_ALLOCATIONS
+void printAllocationReport(std::ostream& out) {
+    /*
+    This function prints the heap allocations and bytes counted against
+    each operation, in total and per operation. "other" is everything
+    outside an operation, such as reading the menu input.
+    */
+    std::ios::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << "========================== ALLOCATIONS ==========================\n"
+        << std::left << std::setw(10) << "Operation" << std::right
+        << std::setw(9) << "Count" << std::setw(11) << "Allocs" << std::setw(13) << "Bytes"
+        << std::setw(11) << "Allocs/op" << std::setw(11) << "Bytes/op" << "\n";
+    out << std::fixed << std::setprecision(1);
+    for (size_t i = 0; i <= static_cast<size_t>(Operation::Count); i++) {
+        Operation operation = static_cast<Operation>(i);
+        AllocationCount count = getAllocationCount(operation);
+        if (count.operations == 0 && count.allocations == 0) continue;
+        out << std::left << std::setw(10) << (operation == Operation::Count ? "other" : operationName(operation))
+            << std::right << std::setw(9) << count.operations
+            << std::setw(11) << count.allocations << std::setw(13) << count.bytes;
+        if (count.operations > 0) {
+            out << std::setw(11) << static_cast<double>(count.allocations) / count.operations
+                << std::setw(11) << static_cast<double>(count.bytes) / count.operations;
+        }
+        out << "\n";
+    }
+    out << "=================================================================\n\n";
+    out.flags(flags);
+    out.precision(precision);
+}
+#endif
+
+
+void searchTasksMenu(TaskList& list) {
+    /*
+    This function asks for search text and prints the tasks whose
+    description contains it (case-sensitive). With the word index on,
+    it prints the tasks that contain every word instead (case-insensitive).
+    */
+    const TaskStore& tasks = list.getTasks();
+    if (tasks.empty()) {
+        std::cout << "No tasks to search.\n";
+        return;
+    }
+
+    std::cin.ignore(); // Clear newline from previous input
+    std::string needle;
+    std::cout << (list.usesWordIndex() ? "Enter words to search for (all must appear): "
+                               : "Enter text to search for: ");
+    std::getline(std::cin, needle);
+    if (needle.empty()) {
+        std::cout << "Search text cannot be empty.\n\n";
+        return;
     }
-    std::cout << "=======================\n" << std::endl;
+
+    std::vector<int> matches;
+    list.find(needle, matches);
+
+    // Print the first page of matches in one write
+    renderBuffer.clear();
+    renderBuffer += "\n====== SEARCH RESULTS ======\n";
+    size_t shown = 0;
+    {
+        OperationScope scope(profile, Operation::Render);
+        for (; shown < matches.size() && shown < pageSize; shown++) {
+            TaskStore::const_iterator it = tasks.findPosition(matches[shown]);
+            renderTaskWindow(it, tasks.end(), 1, renderBuffer);
+        }
+    }
+    char digits[16];
+    if (shown < matches.size()) {
+        renderBuffer += "... and ";
+        renderBuffer.append(digits, std::to_chars(digits, digits + sizeof(digits), matches.size() - shown).ptr);
+        renderBuffer += " more\n";
+    }
+    renderBuffer.append(digits, std::to_chars(digits, digits + sizeof(digits), matches.size()).ptr);
+    renderBuffer += matches.size() == 1 ? " task matches.\n" : " tasks match.\n";
+    renderBuffer += "============================\n\n";
+    writeOutput(renderBuffer);
 }
 
 
-void toggleTaskComplete(std::vector<Task>& tasks) {
+void toggleTaskComplete(TaskList& list) {
     /*
     This function toggles a task as complete/incomplete.
     */
    // Check for empty tasks vector
+    const TaskStore& tasks = list.getTasks();
     if (tasks.empty()) {
         std::cout << "No tasks to toggle.\n";
         return;
     }
 
     // Print current tasks
-    std::cout << "\nCurrent tasks:\n";
-    for (const Task& task : tasks) {
-        std::cout << "[" << (task.isCompleted() ? "x" : " ") << "] "
-                  << task.getId() << ": " << task.getDescription() << "\n";
-    }
-
-    std::cout << std::endl;
+    renderBuffer.clear();
+    renderTaskPreview(tasks, renderBuffer);
+    renderBuffer += '\n';
+    writeOutput(renderBuffer);
 
     // Get ID of task to toggle
     int id;
@@ -238,41 +564,34 @@ void toggleTaskComplete(std::vector<Task>& tasks) {
         return;
     }
 
-    // Iterator through tasks until we found the correct task
-    for (Task& task : tasks) {
-        if (task.getId() == id) {
-            // Toggle complete
-            task.setCompleted(!task.isCompleted());
-            // Confirm message
-            std::cout << "Task " << id << " marked as "
-                      << (task.isCompleted() ? "complete." : "incomplete.") << "\n" << std::endl;
-            // Save to file
-            saveTasksToFile(tasks);
-            return;
-        }
+    // Toggle complete
+    if (list.toggle(id)) {
+        // Confirm message
+        std::cout << "Task " << id << " marked as "
+                  << (tasks.isCompleted(id) ? "complete." : "incomplete.") << "\n\n";
+        return;
     }
 
     // Unable to find task with given ID
-    std::cout << "Task with ID " << id << " not found.\n" << std::endl;
+    std::cout << "Task with ID " << id << " not found.\n\n";
 }
 
 
-void deleteTask(std::vector<Task>& tasks) {
+void deleteTask(TaskList& list) {
     /*
-    This function deletes a task from the tasks vector.
+    This function deletes a task from the list.
     */
    // Check for empty tasks vector
+    const TaskStore& tasks = list.getTasks();
     if (tasks.empty()) {
         std::cout << "No tasks to delete.\n";
         return;
     }
 
     // Print all tasks
-    std::cout << "\nCurrent tasks:\n";
-    for (const Task& task : tasks) {
-        std::cout << "[" << (task.isCompleted() ? "x" : " ") << "] "
-                  << task.getId() << ": " << task.getDescription() << "\n";
-    }
+    renderBuffer.clear();
+    renderTaskPreview(tasks, renderBuffer);
+    writeOutput(renderBuffer);
 
     // Get id of the task to delete
     int id;
@@ -284,39 +603,33 @@ void deleteTask(std::vector<Task>& tasks) {
         return;
     }
 
-    // User iterator to remove the task from the tasks vector
-    for (auto it = tasks.begin(); it != tasks.end(); ++it) {
-        if (it->getId() == id) {
-            tasks.erase(it);
-            std::cout << "Task " << id << " deleted.\n" << std::endl;
-            saveTasksToFile(tasks);
-            return;
-        }
+    // Remove the task from the list
+    if (list.remove(id)) {
+        std::cout << "Task " << id << " deleted.\n\n";
+        return;
     }
 
     // Unable to find task with given ID
-    std::cout << "Task with ID " << id << " not found.\n" << std::endl;
+    std::cout << "Task with ID " << id << " not found.\n\n";
 }
 
 
-void editTask(std::vector<Task>& tasks) {
+void editTask(TaskList& list) {
     /*
     This function edits the description of an existing task.
     */
     // Check if there are any tasks
+    const TaskStore& tasks = list.getTasks();
     if (tasks.empty()) {
         std::cout << "No tasks to edit.\n";
         return;
     }
 
     // Display current tasks
-    std::cout << "\nCurrent tasks:\n";
-    for (const Task& task : tasks) {
-        std::cout << "[" << (task.isCompleted() ? "x" : " ") << "] "
-                  << task.getId() << ": " << task.getDescription() << "\n";
-    }
-
-    std::cout << std::endl;
+    renderBuffer.clear();
+    renderTaskPreview(tasks, renderBuffer);
+    renderBuffer += '\n';
+    writeOutput(renderBuffer);
 
     // Get task ID
     int id;
@@ -329,74 +642,71 @@ void editTask(std::vector<Task>& tasks) {
     }
 
     // Look for the task with the given ID
-    for (Task& task : tasks) {
-        if (task.getId() == id) {
-            std::cin.ignore(); // Clear newline from previous input
-            std::string newDesc;
-            std::cout << "Enter new description: ";
-            std::getline(std::cin, newDesc);
-
-            task.setDescription(newDesc);
-            std::cout << "Task " << id << " updated.\n" << std::endl;
-            saveTasksToFile(tasks); // Save updated tasks
-            return;
-        }
+    if (tasks.contains(id)) {
+        std::cin.ignore(); // Clear newline from previous input
+        std::string newDesc;
+        std::cout << "Enter new description: ";
+        std::getline(std::cin, newDesc);
+
+        list.edit(id, newDesc);
+        std::cout << "Task " << id << " updated.\n\n";
+        return;
     }
 
     // Task ID not found
-    std::cout << "Task with ID " << id << " not found.\n" << std::endl;
+    std::cout << "Task with ID " << id << " not found.\n\n";
 }
 
 
-void loadTasksFromFile(std::vector<Task>& tasks) {
+int runBatch(TaskList& list, const std::string& path) {
     /*
-    This function loads the tasks from the TASKS_FILE file.
-    Each task is expected to be in the format: id|description|completed
+    This function applies every op in a batch file ("-" reads stdin) to the
+    task list without printing the menu, then saves the tasks once.
+    Rejected lines are reported on stderr. It returns the exit status.
     */
-   // Open file for reading
-    std::ifstream file(TASKS_FILE);
-    // Exit if the file cannot be opened
-    if (!file.is_open()) return;
-
-    std::string line;
-    // Read each line from the file
-    while (std::getline(file, line)) {
-        std::stringstream ss(line);
-        std::string idStr, desc, completedStr;
-
-        // Split line into id, description, and completed
-        if (std::getline(ss, idStr, '|') &&
-            std::getline(ss, desc, '|') &&
-            std::getline(ss, completedStr)) {
-
-            int id = std::stoi(idStr); // Convert id string to int
-            bool completed = (completedStr == "1"); // Convert completed to bool
-
-            Task task(desc); // Create task
-            task.setCompleted(completed); // Set completed
-            task.setId(id); // Set ID
-
-            tasks.push_back(task); // Add task to vector
-
-            // Update Task::nextId to avoid collisions
-            if (id >= Task::getNextId()) 
-                Task::setNextId(id + 1);
-        }
+    std::string input;
+    MappedFile file(path == "-" ? std::string() : path);
+    const char* data = file.data();
+    size_t size = file.size();
+    if (path == "-") {
+        input.assign(std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>());
+        data = input.data();
+        size = input.size();
+    } else if (!file.isOpen()) {
+        std::cerr << "Could not open " << path << "\n";
+        return 1;
     }
 
-    file.close();
+    std::vector<RejectedLine> rejected;
+    list.applyBatch(data, size, rejected);
+    for (const RejectedLine& line : rejected) {
+        std::cerr << "Line " << line.number << ": could not apply \"" << line.text << "\"\n";
+    }
+    // The ops are not journaled, so they are lost if the save fails
+    if (!list.save()) {
+        std::cerr << "Could not save the tasks; the batch was not applied\n";
+        return 1;
+    }
+    return rejected.empty() ? 0 : 1;
 }
 
 
-void saveTasksToFile(const std::vector<Task>& tasks) {
+void printUsage(const char* program) {
     /*
-    This function saves the tasks to the TASKS_FILE file.
+    This function prints the command-line options.
     */
-    std::ofstream file(TASKS_FILE);
-    // Write each task to file
-    for (const Task& task : tasks) {
-        file << task.getId() << "|" << task.getDescription() << "|"
-             << (task.isCompleted() ? "1" : "0") << "\n";
-    }
-    file.close();
-}
\ No newline at end of file
+    std::cerr << "Usage: " << program << " [options]\n"
+              << "       " << program << " [options] --stats\n"
+              << "       " << program << " [options] --batch <ops file, or - for stdin>\n"
+              << "       " << program << " [options] --convert <text|binary> <input> <output>\n"
+              << "Options:\n"
+              << "  --durability <none|data|full>  how hard saves sync to disk (default full)\n"
+              << "  --page-size <n>                tasks per page in listings (default "
+              << PAGE_SIZE << ")\n"
+              << "  --word-index                   search by whole words through an index\n"
+              << "  --profile                      time each operation and print latency percentiles\n"
+              << "  --commit-window <ms>           group journal records arriving this close together (default "
+              << GROUP_COMMIT_WINDOW.count() << ", 0 commits each record)\n"
+              << "  --commit-records <n>           commit a group once it has this many records (default "
+              << GROUP_COMMIT_RECORDS << ")\n";
+}
@@ -0,0 +1,2235 @@
+/*
+============================================
+ TODO Task Engine - Implementation
+============================================
+
+ See TaskList.h for what the engine does
+ and the formats of the files it keeps.
+
+============================================
+*/
+
+#include "TaskList.h"
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <vector>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <thread>
+#include <atomic>
+#include <filesystem>
+#include <unordered_map>
+#include <charconv>
+#include <cstring>
+#include <cstdint>
+#include <climits>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define TODO_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// Lets GCC and Clang compile AVX2 and POPCNT code without -mavx2 or
+// -mpopcnt for the whole file
+#if defined(__GNUC__)
+#define TODO_TARGET_AVX2 __attribute__((target("avx2")))
+#define TODO_TARGET_POPCNT __attribute__((target("popcnt")))
+#else
+#define TODO_TARGET_AVX2
+#define TODO_TARGET_POPCNT
+#endif
+
+#if TODO_TRACK_ALLOCATIONS
+#include "AllocationHooks.h"
+#endif
+
+MappedFile::MappedFile(const std::string& path) {
+#if defined(_WIN32)
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return;
+    buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    bytes = buffer.data();
+    length = buffer.size();
+    opened = true;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    struct stat info;
+    if (::fstat(fd, &info) == 0) {
+        opened = true;
+        length = static_cast<size_t>(info.st_size);
+        if (length > 0) {
+            void* mapping = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping == MAP_FAILED) {
+                opened = false;
+                length = 0;
+            } else {
+                ::madvise(mapping, length, MADV_SEQUENTIAL);
+                bytes = static_cast<const char*>(mapping);
+            }
+        }
+    }
+    ::close(fd); // The mapping stays valid after the descriptor is closed
+#endif
+}
+
+
+MappedFile::~MappedFile() {
+#if !defined(_WIN32)
+    if (bytes) ::munmap(const_cast<char*>(bytes), length);
+#endif
+}
+
+
+// Fixed-width header at the start of a word index file. It is followed by
+//   WordIndexEntry entries[wordCount]  sorted by word
+//   WordIndex::Skip skips[skipCount]
+//   char text[textSize]                all words back to back
+//   uint8 postings[postingSize]        all posting lists back to back
+// Integers are stored in host byte order, and every array is 8-byte aligned
+// from the start of the file, so the lists are read straight from a mapping.
+struct WordIndexHeader {
+    char magic[8];        // WordIndex::FILE_MAGIC
+    uint32_t version;     // WordIndex::FILE_VERSION
+    uint32_t reserved;    // Always 0
+    uint64_t checksum;    // contentChecksum of the tasks that were indexed
+    uint64_t wordCount;
+    uint64_t skipCount;
+    uint64_t textSize;
+    uint64_t postingSize;
+};
+static_assert(sizeof(WordIndexHeader) == 56, "word index header must be 56 bytes");
+
+// One word of a word index file
+struct WordIndexEntry {
+    uint64_t textOffset;
+    uint64_t postingOffset;
+    uint64_t postingSize;
+    uint64_t skipOffset;  // Index of the word's first skip entry
+    uint32_t textLength;
+    uint32_t skipCount;
+    uint64_t count;
+    int64_t lastId;
+};
+static_assert(sizeof(WordIndexEntry) == 56, "word index entry must be 56 bytes");
+
+
+class WordIndex {
+public:
+    struct Skip {
+        int64_t previousId; // Id just before the block's first posting
+        uint64_t offset;    // Where the block starts in bytes
+    };
+
+private:
+    // Every SKIP_INTERVAL postings a skip entry marks where a block starts,
+    // so an intersection can gallop over blocks instead of decoding them all
+    static constexpr size_t SKIP_INTERVAL = 64;
+    // Below every id, so the first delta in a list is positive too
+    static constexpr int64_t NO_ID = int64_t(INT32_MIN) - 1;
+
+    // Ids in ascending order, each stored as a varint delta from the one
+    // before. The first id of a block is a delta from the block's previousId,
+    // so one block can be rewritten without touching the others.
+    struct PostingList {
+        std::vector<uint8_t> bytes;
+        std::vector<Skip> skips;
+        int64_t lastId = NO_ID;
+        size_t count = 0;
+        size_t lastBlockCount = 0; // Postings in the last block
+    };
+
+    // A posting list held in memory or in the mapped file
+    struct ListView {
+        const uint8_t* bytes = nullptr;
+        size_t size = 0;
+        const Skip* skips = nullptr;
+        size_t skipCount = 0;
+        size_t count = 0;
+        int64_t lastId = NO_ID;
+    };
+
+    // Words added or changed since the index was loaded. An empty list
+    // hides a word of the mapped file whose last task has gone.
+    std::unordered_map<std::string, PostingList> postings;
+
+    // The index file the rest of the words are read from, if one was loaded
+    std::unique_ptr<MappedFile> file;
+    WordIndexHeader header = {};
+    const WordIndexEntry* entries = nullptr;
+    const Skip* fileSkips = nullptr;
+    const char* fileText = nullptr;
+    const uint8_t* filePostings = nullptr;
+
+    static ListView view(const PostingList& list) {
+        return {list.bytes.data(), list.bytes.size(), list.skips.data(), list.skips.size(),
+                list.count, list.lastId};
+    }
+
+    // Reads the word of a mapped entry. Entries that point outside the file
+    // are treated as missing, so a damaged file cannot cause a bad read.
+    bool mappedWord(const WordIndexEntry& entry, std::string_view& word) const {
+        if (entry.textOffset > header.textSize || entry.textLength > header.textSize - entry.textOffset) {
+            return false;
+        }
+        word = std::string_view(fileText + entry.textOffset, entry.textLength);
+        return true;
+    }
+
+    bool mappedList(const WordIndexEntry& entry, ListView& list) const {
+        bool valid = entry.postingOffset <= header.postingSize &&
+                     entry.postingSize <= header.postingSize - entry.postingOffset &&
+                     entry.skipOffset <= header.skipCount &&
+                     entry.skipCount <= header.skipCount - entry.skipOffset &&
+                     entry.count > 0 && entry.postingSize > 0 && entry.skipCount > 0 &&
+                     // The last varint must end the list, so decoding stays inside it
+                     (filePostings[entry.postingOffset + entry.postingSize - 1] & 0x80) == 0;
+        if (!valid) return false;
+
+        // The skips must split the list at varint boundaries in order, as an
+        // edit copies the list and rewrites blocks between skip offsets
+        const Skip* skips = fileSkips + entry.skipOffset;
+        const uint8_t* bytes = filePostings + entry.postingOffset;
+        if (skips[0].offset != 0 || skips[0].previousId != NO_ID) return false;
+        for (size_t i = 1; i < entry.skipCount; i++) {
+            if (skips[i].offset <= skips[i - 1].offset || skips[i].offset >= entry.postingSize ||
+                skips[i].previousId <= skips[i - 1].previousId || skips[i].previousId > INT32_MAX ||
+                (bytes[skips[i].offset - 1] & 0x80) != 0) return false;
+        }
+        list = {bytes, static_cast<size_t>(entry.postingSize), skips, entry.skipCount,
+                static_cast<size_t>(entry.count), entry.lastId};
+        return true;
+    }
+
+    // Binary searches the mapped file for word
+    bool findMapped(std::string_view word, ListView& list) const {
+        size_t low = 0;
+        size_t high = static_cast<size_t>(header.wordCount);
+        while (low < high) {
+            size_t middle = low + (high - low) / 2;
+            std::string_view other;
+            if (!mappedWord(entries[middle], other)) return false;
+            int order = word.compare(other);
+            if (order > 0) low = middle + 1;
+            else if (order < 0) high = middle;
+            else return mappedList(entries[middle], list);
+        }
+        return false;
+    }
+
+    // Finds the list of a word, in memory or in the mapped file
+    bool findList(const std::string& word, ListView& list) const {
+        auto entry = postings.find(word);
+        if (entry != postings.end()) {
+            list = view(entry->second);
+            return list.count > 0;
+        }
+        return file && findMapped(word, list);
+    }
+
+    // Returns the in-memory list of a word to change, copying it out of the
+    // mapped file first if it is there
+    PostingList& editList(const std::string& word) {
+        auto entry = postings.find(word);
+        if (entry != postings.end()) return entry->second;
+        PostingList& list = postings[word];
+        ListView mapped;
+        if (file && findMapped(word, mapped)) {
+            list.bytes.assign(mapped.bytes, mapped.bytes + mapped.size);
+            list.skips.assign(mapped.skips, mapped.skips + mapped.skipCount);
+            list.count = mapped.count;
+            refreshTail(list);
+        }
+        return list;
+    }
+
+    // Adds an id larger than every id already in the list. The last block
+    // can hold more than SKIP_INTERVAL postings after an older id was
+    // inserted into it, so a full block is any at or over the interval.
+    static void append(PostingList& list, int id) {
+        if (list.skips.empty() || list.lastBlockCount >= SKIP_INTERVAL) {
+            list.skips.push_back({list.lastId, list.bytes.size()});
+            list.lastBlockCount = 0;
+        }
+        writeDelta(list.bytes, list.lastId, id);
+        list.lastId = id;
+        list.lastBlockCount++;
+        list.count++;
+    }
+
+    static void writeDelta(std::vector<uint8_t>& bytes, int64_t previousId, int id) {
+        uint64_t delta = static_cast<uint64_t>(id - previousId);
+        while (delta >= 0x80) {
+            bytes.push_back(static_cast<uint8_t>(delta) | 0x80);
+            delta >>= 7;
+        }
+        bytes.push_back(static_cast<uint8_t>(delta));
+    }
+
+    // Finds the block a posting of id belongs in: the last one that starts
+    // before id. Block 0 starts before every id. The list must not be empty.
+    static size_t blockOf(const PostingList& list, int id) {
+        auto it = std::partition_point(list.skips.begin() + 1, list.skips.end(),
+                                       [id](const Skip& skip) { return skip.previousId < id; });
+        return static_cast<size_t>(it - list.skips.begin()) - 1;
+    }
+
+    // Rewrites one block to hold ids and moves the bytes after it. An empty
+    // block is dropped and an overfull one split in two, so blocks stay near
+    // SKIP_INTERVAL postings and an edit costs one block, not the whole list.
+    static void replaceBlock(PostingList& list, size_t block, const std::vector<int>& ids) {
+        size_t start = static_cast<size_t>(list.skips[block].offset);
+        size_t end = block + 1 < list.skips.size() ? static_cast<size_t>(list.skips[block + 1].offset)
+                                                   : list.bytes.size();
+        bool last = block + 1 == list.skips.size();
+
+        std::vector<uint8_t> encoded;
+        size_t split = ids.size() > 2 * SKIP_INTERVAL ? ids.size() / 2 : ids.size();
+        size_t splitOffset = 0;
+        int64_t previousId = list.skips[block].previousId;
+        for (size_t i = 0; i < ids.size(); i++) {
+            if (i == split) splitOffset = start + encoded.size();
+            writeDelta(encoded, previousId, ids[i]);
+            previousId = ids[i];
+        }
+
+        // Splice the block in and shift the offsets of the blocks after it
+        size_t oldSize = end - start;
+        if (encoded.size() > oldSize) {
+            list.bytes.insert(list.bytes.begin() + end, encoded.size() - oldSize, 0);
+        } else {
+            list.bytes.erase(list.bytes.begin() + start + encoded.size(), list.bytes.begin() + end);
+        }
+        std::copy(encoded.begin(), encoded.end(), list.bytes.begin() + start);
+        for (size_t next = block + 1; next < list.skips.size(); next++) {
+            list.skips[next].offset = list.skips[next].offset + encoded.size() - oldSize;
+        }
+
+        if (ids.empty()) {
+            list.skips.erase(list.skips.begin() + block);
+            // The first block must start below every id; the one that took its
+            // place starts at the id before it, which may be looked up later
+            if (block == 0 && !list.skips.empty()) {
+                std::vector<int> first;
+                decodeBlock(view(list), 0, first);
+                list.skips[0].previousId = NO_ID;
+                replaceBlock(list, 0, first);
+            }
+        } else if (split < ids.size()) {
+            list.skips.insert(list.skips.begin() + block + 1, Skip{ids[split - 1], splitOffset});
+        }
+        if (last) refreshTail(list);
+    }
+
+    // Sets lastId and lastBlockCount from the last block
+    static void refreshTail(PostingList& list) {
+        std::vector<int> ids;
+        if (!list.skips.empty()) decodeBlock(view(list), list.skips.size() - 1, ids);
+        list.lastBlockCount = ids.size();
+        list.lastId = ids.empty() ? NO_ID : ids.back();
+    }
+
+    // Reads the varint at bytes[offset] and moves offset past it
+    static uint64_t readDelta(const uint8_t* bytes, size_t& offset) {
+        uint64_t delta = 0;
+        unsigned shift = 0;
+        while (bytes[offset] & 0x80) {
+            delta |= static_cast<uint64_t>(bytes[offset++] & 0x7F) << shift;
+            shift += 7;
+        }
+        return delta | (static_cast<uint64_t>(bytes[offset++]) << shift);
+    }
+
+    static void decodeBlock(const ListView& list, size_t block, std::vector<int>& ids) {
+        size_t end = block + 1 < list.skipCount ? static_cast<size_t>(list.skips[block + 1].offset) : list.size;
+        end = std::min(end, list.size);
+        int64_t id = list.skips[block].previousId;
+        for (size_t offset = static_cast<size_t>(list.skips[block].offset); offset < end;) {
+            id += static_cast<int64_t>(readDelta(list.bytes, offset));
+            ids.push_back(static_cast<int>(id));
+        }
+    }
+
+    static void decode(const ListView& list, std::vector<int>& ids) {
+        for (size_t block = 0; block < list.skipCount; block++) decodeBlock(list, block, ids);
+    }
+
+    // Where a series of lookups in one list has got to
+    struct Cursor {
+        size_t block = 0;
+        size_t offset = 0;       // Next posting to decode
+        int64_t current = NO_ID; // Last decoded id
+        bool started = false;
+    };
+
+    // Reports whether the list holds id. Ids must be looked up in ascending
+    // order; cursor carries on from where the previous lookup stopped.
+    static bool contains(const ListView& list, int id, Cursor& cursor) {
+        // Move to another block only if id lies past the current one.
+        // Gallop forward to a block that starts past id, then binary search
+        // for the last block that starts before it.
+        size_t next = cursor.block + 1;
+        if (!cursor.started || (next < list.skipCount && list.skips[next].previousId < id)) {
+            size_t low = cursor.block;
+            size_t step = 1;
+            size_t high = low + step;
+            while (high < list.skipCount && list.skips[high].previousId < id) {
+                low = high;
+                step *= 2;
+                high = low + step;
+            }
+            high = std::min(high, list.skipCount);
+            while (high - low > 1) {
+                size_t middle = low + (high - low) / 2;
+                if (list.skips[middle].previousId < id) low = middle;
+                else high = middle;
+            }
+            cursor.block = low;
+            cursor.offset = std::min(static_cast<size_t>(list.skips[low].offset), list.size);
+            cursor.current = list.skips[low].previousId;
+            cursor.started = true;
+        }
+
+        // Decode forward within the block until reaching id or passing it
+        size_t end = cursor.block + 1 < list.skipCount ? static_cast<size_t>(list.skips[cursor.block + 1].offset)
+                                                       : list.size;
+        while (cursor.current < id && cursor.offset < std::min(end, list.size)) {
+            cursor.current += static_cast<int64_t>(readDelta(list.bytes, cursor.offset));
+        }
+        return cursor.current == id;
+    }
+
+public:
+    // Word index file identification
+    static constexpr char FILE_MAGIC[8] = {'T', 'O', 'D', 'O', 'W', 'I', 'D', 'X'};
+    static constexpr uint32_t FILE_VERSION = 1;
+
+    // Splits text into lowercase words (runs of letters, digits and non-ASCII
+    // bytes) and leaves each word in words once, sorted
+    static void tokenize(std::string_view text, std::vector<std::string>& words) {
+        words.clear();
+        size_t i = 0;
+        while (i < text.size()) {
+            while (i < text.size() && !isWordByte(text[i])) i++;
+            size_t start = i;
+            while (i < text.size() && isWordByte(text[i])) i++;
+            if (i == start) break;
+            std::string word(text.substr(start, i - start));
+            for (char& c : word) {
+                if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+            }
+            words.push_back(std::move(word));
+        }
+        std::sort(words.begin(), words.end());
+        words.erase(std::unique(words.begin(), words.end()), words.end());
+    }
+
+    static bool isWordByte(char c) {
+        unsigned char byte = static_cast<unsigned char>(c);
+        return (byte >= 'a' && byte <= 'z') || (byte >= 'A' && byte <= 'Z') ||
+               (byte >= '0' && byte <= '9') || byte >= 0x80;
+    }
+
+    // Indexes every task in the store, replacing what was indexed before
+    void build(const TaskStore& tasks) {
+        postings.clear();
+        file.reset();
+        for (const Task& task : tasks) add(task.getId(), task.getDescription());
+    }
+
+    // Indexes the words of one task's description
+    void add(int id, std::string_view description) {
+        std::vector<std::string> words;
+        tokenize(description, words);
+        std::vector<int> ids;
+        for (const std::string& word : words) {
+            PostingList& list = editList(word);
+            if (list.count == 0 || id > list.lastId) {
+                append(list, id); // New tasks have the highest id, so this is the usual case
+                continue;
+            }
+            // An older id: only the block it falls in is rewritten
+            size_t block = blockOf(list, id);
+            ids.clear();
+            decodeBlock(view(list), block, ids);
+            auto it = std::lower_bound(ids.begin(), ids.end(), id);
+            if (it != ids.end() && *it == id) continue;
+            ids.insert(it, id);
+            replaceBlock(list, block, ids);
+            list.count++;
+        }
+    }
+
+    // Removes a task from the lists of the words in its description
+    void remove(int id, std::string_view description) {
+        std::vector<std::string> words;
+        tokenize(description, words);
+        std::vector<int> ids;
+        for (const std::string& word : words) {
+            ListView found;
+            if (!findList(word, found)) continue;
+            // Only the block holding id is rewritten
+            PostingList& list = editList(word);
+            size_t block = blockOf(list, id);
+            ids.clear();
+            decodeBlock(view(list), block, ids);
+            auto it = std::lower_bound(ids.begin(), ids.end(), id);
+            if (it == ids.end() || *it != id) continue;
+            ids.erase(it);
+            replaceBlock(list, block, ids);
+            list.count--; // An empty list stays to hide the mapped one
+        }
+    }
+
+    // Leaves the ids of the tasks that contain every word of query in matches,
+    // in ascending order
+    void find(std::string_view query, std::vector<int>& matches) const {
+        matches.clear();
+        std::vector<std::string> words;
+        tokenize(query, words);
+        if (words.empty()) return;
+
+        std::vector<ListView> lists(words.size());
+        for (size_t i = 0; i < words.size(); i++) {
+            if (!findList(words[i], lists[i])) return; // No task has this word
+        }
+
+        // Start from the shortest list and check its ids against the others
+        std::sort(lists.begin(), lists.end(), [](const ListView& a, const ListView& b) {
+            return a.count < b.count;
+        });
+        decode(lists[0], matches);
+        for (size_t i = 1; i < lists.size() && !matches.empty(); i++) {
+            Cursor cursor;
+            size_t kept = 0;
+            for (int id : matches) {
+                if (contains(lists[i], id, cursor)) matches[kept++] = id;
+            }
+            matches.resize(kept);
+        }
+    }
+
+    // Writes the index to buffer in the file layout (see WordIndexHeader),
+    // tagged with the checksum of the tasks it indexes
+    void serialize(uint64_t checksum, std::string& buffer) const {
+        // Merge the words in memory with the mapped ones, which are already
+        // sorted; a word in memory replaces the mapped one
+        using Word = std::pair<std::string_view, ListView>;
+        auto byWord = [](const Word& a, const Word& b) { return a.first < b.first; };
+        std::vector<Word> changed;
+        changed.reserve(postings.size());
+        for (const auto& entry : postings) changed.emplace_back(entry.first, view(entry.second));
+        std::sort(changed.begin(), changed.end(), byWord);
+
+        std::vector<Word> words;
+        words.reserve(changed.size() + (file ? static_cast<size_t>(header.wordCount) : 0));
+        size_t next = 0;
+        for (size_t i = 0; file && i < header.wordCount; i++) {
+            Word mapped;
+            if (!mappedWord(entries[i], mapped.first) || !mappedList(entries[i], mapped.second)) continue;
+            for (; next < changed.size() && changed[next].first < mapped.first; next++) {
+                words.push_back(changed[next]);
+            }
+            if (next < changed.size() && changed[next].first == mapped.first) {
+                words.push_back(changed[next++]);
+            } else {
+                words.push_back(mapped);
+            }
+        }
+        words.insert(words.end(), changed.begin() + next, changed.end());
+        // Words whose last task has gone are left out
+        words.erase(std::remove_if(words.begin(), words.end(), [](const Word& word) {
+            return word.second.count == 0;
+        }), words.end());
+
+        WordIndexHeader out;
+        std::memcpy(out.magic, FILE_MAGIC, sizeof(out.magic));
+        out.version = FILE_VERSION;
+        out.reserved = 0;
+        out.checksum = checksum;
+        out.wordCount = words.size();
+        out.skipCount = 0;
+        out.textSize = 0;
+        out.postingSize = 0;
+        for (const auto& word : words) {
+            out.skipCount += word.second.skipCount;
+            out.textSize += word.first.size();
+            out.postingSize += word.second.size;
+        }
+
+        buffer.resize(sizeof(out) + words.size() * sizeof(WordIndexEntry) +
+                      out.skipCount * sizeof(Skip) + out.textSize + out.postingSize);
+        char* entryColumn = &buffer[0] + sizeof(out);
+        char* skips = entryColumn + words.size() * sizeof(WordIndexEntry);
+        char* text = skips + out.skipCount * sizeof(Skip);
+        char* bytes = text + out.textSize;
+        std::memcpy(&buffer[0], &out, sizeof(out));
+
+        WordIndexEntry entry = {};
+        for (size_t i = 0; i < words.size(); i++) {
+            std::string_view word = words[i].first;
+            const ListView& list = words[i].second;
+            entry.textLength = static_cast<uint32_t>(word.size());
+            entry.postingSize = list.size;
+            entry.skipCount = static_cast<uint32_t>(list.skipCount);
+            entry.count = list.count;
+            entry.lastId = list.lastId;
+            std::memcpy(entryColumn + i * sizeof(entry), &entry, sizeof(entry));
+            std::memcpy(text + entry.textOffset, word.data(), word.size());
+            std::memcpy(bytes + entry.postingOffset, list.bytes, list.size);
+            std::memcpy(skips + entry.skipOffset * sizeof(Skip), list.skips, list.skipCount * sizeof(Skip));
+            entry.textOffset += entry.textLength;
+            entry.postingOffset += entry.postingSize;
+            entry.skipOffset += entry.skipCount;
+        }
+    }
+
+    // Replaces the index with the word index file at path and reports success.
+    // The file stays mapped and lists are read from it as words are searched.
+    // A missing file, one from another version, or one built from other tasks
+    // (a checksum that differs) is rejected and leaves the index empty.
+    bool load(const std::string& path, uint64_t checksum) {
+        postings.clear();
+        file.reset();
+        auto mapped = std::make_unique<MappedFile>(path);
+        const char* data = mapped->data();
+        size_t size = mapped->size();
+        if (size < sizeof(header)) return false;
+        std::memcpy(&header, data, sizeof(header));
+        if (std::memcmp(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0 ||
+            header.version != FILE_VERSION || header.checksum != checksum) return false;
+
+        // The arrays must fill the file exactly
+        size_t rest = size - sizeof(header);
+        if (header.wordCount > rest / sizeof(WordIndexEntry)) return false;
+        rest -= header.wordCount * sizeof(WordIndexEntry);
+        if (header.skipCount > rest / sizeof(Skip)) return false;
+        rest -= header.skipCount * sizeof(Skip);
+        if (header.textSize > rest || header.postingSize != rest - header.textSize) return false;
+
+        // The mapping is page-aligned and every array starts on an 8-byte boundary
+        entries = reinterpret_cast<const WordIndexEntry*>(data + sizeof(header));
+        fileSkips = reinterpret_cast<const Skip*>(entries + header.wordCount);
+        fileText = reinterpret_cast<const char*>(fileSkips + header.skipCount);
+        filePostings = reinterpret_cast<const uint8_t*>(fileText + header.textSize);
+        file = std::move(mapped);
+        return true;
+    }
+};
+static_assert(sizeof(WordIndex::Skip) == 16, "word index skip entry must be 16 bytes");
+
+
+// Tasks parsed from one part of a snapshot file
+struct SnapshotChunk {
+    std::vector<Task> tasks;
+    int highestId = 0;
+};
+
+
+// Fixed-width header at the start of a binary snapshot.
+// Integers are stored in host byte order (little-endian on every supported platform).
+struct BinarySnapshotHeader {
+    char magic[8];        // BINARY_MAGIC
+    uint32_t version;     // BINARY_VERSION
+    uint32_t reserved;    // Always 0
+    uint64_t count;       // Number of tasks
+    uint64_t blobSize;    // Bytes of description text
+};
+static_assert(sizeof(BinarySnapshotHeader) == 32, "binary snapshot header must be 32 bytes");
+
+
+static bool syncFileData(int fd);
+static bool syncDirectory(const std::string& path);
+
+
+class JournalWriter {
+private:
+    std::string path;
+    std::FILE* file = nullptr;
+    Durability mode = Durability::Full;
+    std::chrono::milliseconds window{5};
+    size_t maxRecords = 1000;
+
+    // Records waiting for the next commit, guarded by pendingMutex
+    std::mutex pendingMutex;
+    std::condition_variable wake;
+    std::string pending;
+    size_t pendingRecords = 0;
+    std::chrono::steady_clock::time_point firstPendingAt;
+    bool stopping = false;
+    std::thread flusher;
+
+    // Held while a batch is written so batches reach the file in order
+    std::mutex writeMutex;
+    // Bytes of whole batches in the file, guarded by writeMutex
+    std::uintmax_t committedSize = 0;
+    // Set when a batch could not be written, guarded by writeMutex. Later
+    // batches are dropped too, so the file stays a prefix of the changes
+    // with no gap, until discard() empties it once a snapshot holds them.
+    bool failed = false;
+
+    // Commits pending records once the oldest has waited for the whole window
+    void flushLoop() {
+        std::unique_lock<std::mutex> lock(pendingMutex);
+        while (!stopping) {
+            if (pending.empty()) {
+                wake.wait(lock);
+                continue;
+            }
+            auto deadline = firstPendingAt + window;
+            if (wake.wait_until(lock, deadline, [this]() { return stopping || pending.empty(); })) continue;
+            lock.unlock();
+            commit();
+            lock.lock();
+        }
+    }
+
+    // Appends one batch to the file and syncs it; writeMutex must be held.
+    // With Durability::Full the directory is synced too after the file is
+    // opened, since it may have just been created (e.g. after a rotation).
+    // A batch that fails is cut off again, so no partial record is left
+    // for the next one to be appended to.
+    bool writeBatch(const std::string& batch) {
+        bool opened = false;
+        std::error_code ec;
+        if (!file) {
+            file = std::fopen(path.c_str(), "ab");
+            committedSize = std::filesystem::file_size(path, ec);
+            if (ec) committedSize = 0;
+            opened = true;
+        }
+        if (!file) return false;
+        bool ok = std::fwrite(batch.data(), 1, batch.size(), file) == batch.size() &&
+                  std::fflush(file) == 0;
+#if !defined(_WIN32)
+        if (ok && mode != Durability::None) ok = syncFileData(fileno(file));
+#endif
+        if (ok && opened && mode == Durability::Full) ok = syncDirectory(path);
+        if (ok) {
+            committedSize += batch.size();
+            return true;
+        }
+        std::fclose(file);
+        file = nullptr;
+        std::filesystem::resize_file(path, committedSize, ec);
+        return false;
+    }
+
+public:
+    explicit JournalWriter(std::string path) : path(std::move(path)) {}
+
+    ~JournalWriter() {
+        stop();
+    }
+
+    JournalWriter(const JournalWriter&) = delete;
+    JournalWriter& operator=(const JournalWriter&) = delete;
+
+    // Sets how records are synced and how long and how many of them are grouped.
+    // A window of 0 commits every record as it is appended.
+    void configure(Durability mode, std::chrono::milliseconds window, size_t maxRecords) {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        this->mode = mode;
+        this->window = window;
+        this->maxRecords = std::max<size_t>(maxRecords, 1);
+    }
+
+    // Queues one record; it is written with the rest of its group
+    void append(const std::string& record) {
+        bool commitNow;
+        {
+            std::lock_guard<std::mutex> lock(pendingMutex);
+            if (pending.empty()) firstPendingAt = std::chrono::steady_clock::now();
+            pending += record;
+            pendingRecords++;
+            commitNow = stopping || window.count() == 0 || pendingRecords >= maxRecords;
+            if (!commitNow && !flusher.joinable()) {
+                flusher = std::thread(&JournalWriter::flushLoop, this);
+            }
+        }
+        if (commitNow) commit();
+        else wake.notify_one();
+    }
+
+    // Writes every pending record in one write and reports whether every
+    // batch since the last discard() was written
+    bool commit() {
+        std::lock_guard<std::mutex> io(writeMutex);
+        std::string batch;
+        {
+            std::lock_guard<std::mutex> lock(pendingMutex);
+            batch.swap(pending);
+            pendingRecords = 0;
+        }
+        if (failed || batch.empty()) return !failed;
+        failed = !writeBatch(batch);
+        return !failed;
+    }
+
+    // Commits pending records and closes the file; the next append reopens it.
+    // Reports whether every batch since the last discard() was written.
+    bool close() {
+        bool ok = commit();
+        std::lock_guard<std::mutex> io(writeMutex);
+        if (file && std::fclose(file) != 0) {
+            failed = true;
+            ok = false;
+        }
+        file = nullptr;
+        return ok;
+    }
+
+    // Drops pending records and empties the file, once a snapshot holds them
+    void discard() {
+        std::lock_guard<std::mutex> io(writeMutex);
+        {
+            std::lock_guard<std::mutex> lock(pendingMutex);
+            pending.clear();
+            pendingRecords = 0;
+        }
+        if (file) std::fclose(file);
+        file = std::fopen(path.c_str(), "wb");
+        if (file) std::fclose(file);
+        file = nullptr;
+        committedSize = 0;
+        failed = false;
+    }
+
+    // Commits pending records and stops the flusher thread. Reports whether
+    // every batch since the last discard() was written.
+    bool stop() {
+        {
+            std::lock_guard<std::mutex> lock(pendingMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        if (flusher.joinable()) flusher.join();
+        return close();
+    }
+};
+
+
+/*
+====== Function declarations ======
+*/
+static void searchTasks(const TaskStore& tasks, std::string_view needle, std::vector<int>& matches);
+static size_t replayJournal(TaskStore& tasks, const std::string& path);
+static bool readSnapshot(TaskStore& tasks, const std::string& path, SnapshotFormat& format);
+static bool parseBinarySnapshot(SnapshotChunk& chunk, const char* data, size_t size);
+static bool isBinarySnapshot(const char* data, size_t size);
+static std::vector<SnapshotChunk> parseSnapshotChunks(const char* data, size_t size, unsigned threads);
+static void parseSnapshot(SnapshotChunk& chunk, const char* data, size_t size);
+static void parseSnapshotRecord(SnapshotChunk& chunk, const char* line, const char* firstPipe,
+                                const char* lastPipe, const char* lineEnd);
+static bool parseId(const char* first, const char* last, int& id);
+static size_t scanDelimitersScalar(const char* data, size_t size, uint32_t* offsets);
+#if TODO_X86
+static size_t scanDelimitersSse2(const char* data, size_t size, uint32_t* offsets);
+static size_t scanDelimitersAvx2(const char* data, size_t size, uint32_t* offsets);
+static bool cpuHasAvx2();
+#endif
+static unsigned countTrailingZeros(uint32_t mask);
+static unsigned highestBit(uint64_t value);
+static size_t findSubstringScalar(const char* text, size_t size, const char* needle, size_t needleSize);
+#if TODO_X86
+static size_t findSubstringSse2(const char* text, size_t size, const char* needle, size_t needleSize);
+static size_t findSubstringAvx2(const char* text, size_t size, const char* needle, size_t needleSize);
+#endif
+static size_t countLiveBitsScalar(const uint64_t* completed, const uint64_t* dead, size_t words);
+#if TODO_X86
+static size_t countLiveBitsPopcnt(const uint64_t* completed, const uint64_t* dead, size_t words);
+static bool cpuHasPopcnt();
+#endif
+static void formatTextSnapshot(const TaskStore& tasks, std::string& buffer);
+static void formatBinarySnapshot(const TaskStore& tasks, std::string& buffer);
+static bool replaceFile(const std::string& path, const std::string& contents, Durability durability);
+static bool writeAll(int fd, const char* data, size_t size);
+static uint64_t contentChecksum(const TaskStore& tasks);
+
+
+// Tracks auto-increment id for tasks
+int Task::nextId = 1;
+// New file contents are written next to the file with this suffix, then renamed over it
+const std::string TEMP_SUFFIX = ".tmp";
+
+// Binary snapshot identification
+const char BINARY_MAGIC[8] = {'T', 'O', 'D', 'O', 'S', 'N', 'A', 'P'};
+const uint32_t BINARY_VERSION = 1;
+
+// Journal record types
+const char JOURNAL_ADD = 'A';
+const char JOURNAL_COMPLETE = 'C';
+const char JOURNAL_EDIT = 'E';
+const char JOURNAL_DELETE = 'D';
+
+// Delimiter scanner for the snapshot parser, picked for this CPU on first use.
+// It writes the offsets of every '\n' and '|' in a block and returns how many.
+using DelimiterScanner = size_t (*)(const char* data, size_t size, uint32_t* offsets);
+static DelimiterScanner selectDelimiterScanner();
+static size_t scanDelimiters(const char* data, size_t size, uint32_t* offsets);
+
+// Completion bit counter for TaskStore::countCompleted, picked for this CPU on first use
+using LiveBitCounter = size_t (*)(const uint64_t* completed, const uint64_t* dead, size_t words);
+static LiveBitCounter selectLiveBitCounter();
+
+// Substring finder for search, picked for this CPU on first use.
+// It returns the position of needle in text, or NOT_FOUND.
+using SubstringFinder = size_t (*)(const char* text, size_t size, const char* needle, size_t needleSize);
+static SubstringFinder selectSubstringFinder();
+static size_t findSubstring(const char* text, size_t size, const char* needle, size_t needleSize);
+const size_t NOT_FOUND = static_cast<size_t>(-1);
+
+// The snapshot is scanned in blocks this size so the offsets stay in cache
+const size_t SCAN_BLOCK_SIZE = 64 * 1024;
+
+// Snapshots at least this big are parsed on one thread per core
+const size_t PARALLEL_LOAD_MIN_SIZE = 16 * 1024 * 1024;
+
+
+void LatencyHistogram::record(uint64_t nanoseconds) {
+    /*
+    This function counts one latency.
+    */
+    counts[bucketOf(nanoseconds)]++;
+    total++;
+    if (nanoseconds > max) max = nanoseconds;
+}
+
+
+uint64_t LatencyHistogram::valueAtPercentile(double percentile) const {
+    /*
+    This function walks the buckets until percentile percent of the
+    recordings are behind it and returns the top of that bucket.
+    */
+    if (total == 0) return 0;
+    uint64_t rank = static_cast<uint64_t>(percentile / 100.0 * static_cast<double>(total) + 0.5);
+    rank = std::clamp<uint64_t>(rank, 1, total);
+
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < BUCKET_COUNT; bucket++) {
+        seen += counts[bucket];
+        if (seen >= rank) return std::min(highestValueIn(bucket), max);
+    }
+    return max;
+}
+
+
+size_t LatencyHistogram::bucketOf(uint64_t nanoseconds) {
+    /*
+    This function returns the bucket a latency is counted in. Values below
+    2 * SUB_BUCKETS are their own bucket; above that, the top SUB_BUCKET_BITS
+    bits under the highest set bit pick the bucket within its power of two.
+    */
+    if (nanoseconds < 2 * SUB_BUCKETS) return static_cast<size_t>(nanoseconds);
+    unsigned shift = highestBit(nanoseconds) - SUB_BUCKET_BITS;
+    return (shift + 1) * SUB_BUCKETS + ((nanoseconds >> shift) & (SUB_BUCKETS - 1));
+}
+
+
+uint64_t LatencyHistogram::highestValueIn(size_t bucket) {
+    /*
+    This function returns the largest latency counted in a bucket.
+    */
+    if (bucket < 2 * SUB_BUCKETS) return bucket;
+    unsigned shift = static_cast<unsigned>(bucket / SUB_BUCKETS - 1);
+    uint64_t lowest = static_cast<uint64_t>(SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+    return lowest + ((uint64_t(1) << shift) - 1);
+}
+
+
+#if TODO_TRACK_ALLOCATIONS
+// Heap use per Operation, with the last entry for allocations outside any.
+// Atomic because the journal and compaction threads allocate too, and
+// zero-initialized so they count allocations made before main.
+struct AllocationCounters {
+    std::atomic<uint64_t> operations;
+    std::atomic<uint64_t> allocations;
+    std::atomic<uint64_t> bytes;
+};
+static AllocationCounters allocationCounters[static_cast<size_t>(Operation::Count) + 1];
+
+thread_local Operation currentOperation = Operation::Count;
+
+
+void countOperation(Operation operation) {
+    /*
+    This function counts one finished scope of an operation.
+    */
+    allocationCounters[static_cast<size_t>(operation)].operations.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+AllocationCount getAllocationCount(Operation operation) {
+    /*
+    This function returns the heap use counted against an operation so far.
+    */
+    const AllocationCounters& counters = allocationCounters[static_cast<size_t>(operation)];
+    return {counters.operations.load(std::memory_order_relaxed),
+            counters.allocations.load(std::memory_order_relaxed),
+            counters.bytes.load(std::memory_order_relaxed)};
+}
+
+
+void countAllocation(std::size_t size) {
+    /*
+    This function counts one allocation against the operation this thread
+    is in. AllocationHooks.h calls it from operator new.
+    */
+    AllocationCounters& counters = allocationCounters[static_cast<size_t>(currentOperation)];
+    counters.allocations.fetch_add(1, std::memory_order_relaxed);
+    counters.bytes.fetch_add(size, std::memory_order_relaxed);
+}
+#endif
+
+
+TaskList::TaskList(const std::string& tasksFile)
+    : tasksFile(tasksFile), compactRecordLimit(COMPACT_RECORD_LIMIT), compactByteLimit(COMPACT_BYTE_LIMIT),
+      wordIndex(std::make_unique<WordIndex>()) {
+    std::filesystem::path base(tasksFile);
+    journalFile = base.replace_extension(".journal").string();
+    compactingFile = journalFile + ".compacting";
+    indexFile = base.replace_extension(".index").string();
+    journal = std::make_unique<JournalWriter>(journalFile);
+}
+
+
+TaskList::~TaskList() {
+    close();
+}
+
+
+void TaskList::configure(Durability durability, std::chrono::milliseconds commitWindow, size_t commitRecords) {
+    /*
+    This function sets how hard saves and journal commits sync to disk,
+    and how journal records are grouped into commits.
+    */
+    this->durability = durability;
+    journal->configure(durability, commitWindow, commitRecords);
+}
+
+
+void TaskList::setWordIndex(bool enabled) {
+    /*
+    This function turns the word index on or off. It is readied the first
+    time it is needed, not here.
+    */
+    useWordIndex = enabled;
+}
+
+
+void TaskList::setProfiling(bool enabled) {
+    /*
+    This function turns latency profiling on or off.
+    */
+    if (!enabled) profile.reset();
+    else if (!profile) profile = std::make_unique<LatencyProfile>();
+}
+
+
+void TaskList::setCompactionLimits(size_t records, std::uintmax_t bytes) {
+    /*
+    This function sets the journal size that starts a background compaction.
+    */
+    compactRecordLimit = records;
+    compactByteLimit = bytes;
+}
+
+
+bool TaskList::load() {
+    /*
+    This function loads the tasks from the snapshot and replays the journal.
+    It reports whether the snapshot could be read.
+    */
+    OperationScope scope(profile.get(), Operation::Load);
+    if (!readSnapshot(tasks, tasksFile, snapshotFormat)) {
+        // The journal only makes sense on top of the snapshot, so leave both alone
+        snapshotUnreadable = true;
+        return false;
+    }
+
+    // Apply changes made since the snapshot was written.
+    // A leftover compacting journal means a compaction was interrupted.
+    replayJournal(tasks, compactingFile);
+    journalRecords = replayJournal(tasks, journalFile);
+
+    std::error_code ec;
+    journalBytes = std::filesystem::file_size(journalFile, ec);
+    if (ec) journalBytes = 0;
+
+    // Update Task::nextId to avoid collisions
+    if (tasks.getHighestId() >= Task::getNextId())
+        Task::setNextId(tasks.getHighestId() + 1);
+    return true;
+}
+
+
+bool TaskList::save() {
+    /*
+    This function saves the tasks to the snapshot and reports success.
+    The snapshot contains every journaled change, so the journal is emptied.
+    */
+    OperationScope scope(profile.get(), Operation::Save);
+    if (snapshotUnreadable) return false;
+    // A running compaction would otherwise replace the new snapshot
+    finishCompaction();
+
+    if (!writeSnapshot(tasks, tasksFile, snapshotFormat, durability)) return false;
+
+    // Start a fresh journal
+    journal->discard();
+    std::error_code ec;
+    std::filesystem::remove(compactingFile, ec);
+    journalRecords = 0;
+    journalBytes = 0;
+    return true;
+}
+
+
+bool TaskList::close() {
+    /*
+    This function commits the last group of journal records, waits for a
+    running compaction and writes the word index back if it changed.
+    It reports whether every journal record since the last save was written.
+    */
+    OperationScope scope(profile.get(), Operation::Close);
+    bool journaled = journal->stop();
+    finishCompaction();
+    saveWordIndex();
+    return journaled;
+}
+
+
+int TaskList::add(std::string_view description) {
+    /*
+    This function adds a new task and returns its id, or -1 if the
+    description is not a single line.
+    */
+    OperationScope scope(profile.get(), Operation::Add);
+    if (description.find('\n') != std::string_view::npos) return -1;
+    // Ready the index before the add, while the tasks still match indexFile
+    bool indexed = prepareWordIndex();
+    Task task(description);
+    tasks.add(task);
+    if (indexed) {
+        wordIndex->add(task.getId(), description);
+        wordIndexChanged = true;
+    }
+    appendJournalRecord(JOURNAL_ADD, task.getId(), description);
+    return task.getId();
+}
+
+
+bool TaskList::toggle(int id) {
+    /*
+    This function flips whether a task is completed and reports whether
+    the task exists.
+    */
+    OperationScope scope(profile.get(), Operation::Toggle);
+    if (!tasks.contains(id)) return false;
+    bool completed = !tasks.isCompleted(id);
+    tasks.setCompleted(id, completed);
+    appendJournalRecord(JOURNAL_COMPLETE, id, completed ? "1" : "0");
+    return true;
+}
+
+
+bool TaskList::edit(int id, std::string_view description) {
+    /*
+    This function replaces the description of a task and reports whether
+    the task exists and the new description is a single line.
+    */
+    OperationScope scope(profile.get(), Operation::Edit);
+    if (!tasks.contains(id) || description.find('\n') != std::string_view::npos) return false;
+    bool indexed = prepareWordIndex();
+    if (indexed) wordIndex->remove(id, tasks.getDescription(id));
+    tasks.setDescription(id, description);
+    if (indexed) {
+        wordIndex->add(id, description);
+        wordIndexChanged = true;
+    }
+    appendJournalRecord(JOURNAL_EDIT, id, description);
+    return true;
+}
+
+
+bool TaskList::remove(int id) {
+    /*
+    This function deletes a task and reports whether it existed.
+    */
+    OperationScope scope(profile.get(), Operation::Delete);
+    if (!tasks.contains(id)) return false;
+    if (prepareWordIndex()) {
+        wordIndex->remove(id, tasks.getDescription(id));
+        wordIndexChanged = true;
+    }
+    tasks.remove(id);
+    appendJournalRecord(JOURNAL_DELETE, id, "");
+    return true;
+}
+
+
+void TaskList::find(std::string_view text, std::vector<int>& matches) {
+    /*
+    This function finds the tasks whose description contains text
+    (case-sensitive). With the word index on, it finds the tasks that
+    contain every word of text instead (case-insensitive).
+    */
+    OperationScope scope(profile.get(), Operation::Find);
+    matches.clear();
+    if (prepareWordIndex()) wordIndex->find(text, matches);
+    else searchTasks(tasks, text, matches);
+}
+
+
+size_t TaskList::applyBatch(const char* data, size_t size, std::vector<RejectedLine>& rejected) {
+    /*
+    This function applies one op per line and returns how many lines it rejected.
+    Each line is one of:
+      add <description>
+      toggle <id>
+      edit <id> <description>
+      delete <id>
+    Blank lines are ignored. Lines that cannot be applied go to rejected.
+    */
+    const char* end = data + size;
+    const char* line = data;
+    size_t lineNumber = 0;
+    size_t count = 0;
+
+    while (line < end) {
+        const char* lineEnd = static_cast<const char*>(std::memchr(line, '\n', end - line));
+        if (!lineEnd) lineEnd = end;
+        const char* next = lineEnd + 1;
+        lineNumber++;
+        if (lineEnd > line && lineEnd[-1] == '\r') lineEnd--; // Accept CRLF files
+
+        if (lineEnd > line) {
+            OperationScope scope(profile.get(), Operation::BatchOp);
+            if (!applyBatchOp(line, lineEnd)) {
+                rejected.push_back({lineNumber, std::string_view(line, lineEnd - line)});
+                count++;
+            }
+        }
+        line = next;
+    }
+
+    // The index was not kept up to date, so ready it again when next needed
+    wordIndexReady = false;
+    return count;
+}
+
+
+bool TaskList::applyBatchOp(const char* line, const char* lineEnd) {
+    /*
+    This function applies the op on one batch line and reports whether it
+    was valid and named an existing task.
+    */
+    // Split the op name from its arguments
+    const char* space = static_cast<const char*>(std::memchr(line, ' ', lineEnd - line));
+    const char* args = space ? space + 1 : lineEnd;
+    std::string op(line, space ? space : lineEnd);
+
+    if (op == "add") {
+        tasks.add(Task(std::string_view(args, lineEnd - args)));
+        return true;
+    }
+
+    // Every other op starts with a task id
+    const char* idEnd = static_cast<const char*>(std::memchr(args, ' ', lineEnd - args));
+    if (!idEnd) idEnd = lineEnd;
+    int id;
+    if (!parseId(args, idEnd, id)) return false;
+
+    if (op == "delete") return idEnd == lineEnd && tasks.remove(id);
+
+    if (op == "toggle" && idEnd == lineEnd) {
+        return tasks.setCompleted(id, !tasks.isCompleted(id));
+    }
+    if (op == "edit" && idEnd < lineEnd) {
+        return tasks.setDescription(id, std::string_view(idEnd + 1, lineEnd - idEnd - 1));
+    }
+    return false;
+}
+
+
+void TaskList::appendJournalRecord(char op, int id, std::string_view payload) {
+    /*
+    This function appends a single change record to the journal.
+    Each record is in the format: op|id|payload
+    */
+    std::string record;
+    record.reserve(payload.size() + 16);
+    record += op;
+    record += '|';
+    char digits[16];
+    record.append(digits, std::to_chars(digits, digits + sizeof(digits), id).ptr);
+    record += '|';
+    record += payload;
+    record += '\n';
+    journal->append(record); // Written with the rest of its group
+
+    journalRecords++;
+    journalBytes += payload.size() + 16;
+    maybeCompactJournal();
+}
+
+
+void TaskList::maybeCompactJournal() {
+    /*
+    This function starts a background compaction once the journal is big enough.
+    The journal is renamed to compactingFile so new records go to a fresh journal
+    while the worker folds the old one into the snapshot.
+    */
+    if (journalRecords < compactRecordLimit && journalBytes < compactByteLimit) return;
+    // Try again on a later mutation if a compaction is still running
+    if (compactionRunning) return;
+    if (compactionThread.joinable()) compactionThread.join();
+
+    // Finish an interrupted compaction before rotating the journal again
+    std::error_code ec;
+    if (!std::filesystem::exists(compactingFile, ec)) {
+        journal->close();
+        std::filesystem::rename(journalFile, compactingFile, ec);
+        if (ec) return;
+        // Records already reported as saved now live in compactingFile
+        if (durability == Durability::Full) syncDirectory(compactingFile);
+        journalRecords = 0;
+        journalBytes = 0;
+    }
+
+    compactionRunning = true;
+    compactionThread = std::thread(&TaskList::compactJournal, this, snapshotFormat);
+}
+
+
+void TaskList::compactJournal(SnapshotFormat format) {
+    /*
+    This function folds compactingFile into a new snapshot of the given
+    format and swaps it in.
+    It runs on the compaction thread and only works on files, never on
+    the tasks in memory.
+    */
+    try {
+        // An unreadable snapshot stays as it is, and so does the compacting journal
+        TaskStore snapshot;
+        if (!readSnapshot(snapshot, tasksFile, format)) {
+            compactionRunning = false;
+            return;
+        }
+        replayJournal(snapshot, compactingFile);
+
+        // The new snapshot is renamed over the old one in one step
+        if (writeSnapshot(snapshot, tasksFile, format, durability)) {
+            std::error_code ec;
+            std::filesystem::remove(compactingFile, ec);
+        }
+    } catch (const std::exception&) {
+        // Leave the compacting journal in place so it is replayed next time
+    }
+    compactionRunning = false;
+}
+
+
+void TaskList::finishCompaction() {
+    /*
+    This function waits for a running compaction to finish.
+    */
+    if (compactionThread.joinable()) compactionThread.join();
+}
+
+
+bool TaskList::prepareWordIndex() {
+    /*
+    This function reports whether the word index is on, and readies it
+    the first time it is needed. indexFile is used if it was written for
+    the same tasks; otherwise the index is rebuilt from the tasks.
+    */
+    if (!useWordIndex) return false;
+    if (wordIndexReady) return true;
+
+    if (!wordIndex->load(indexFile, contentChecksum(tasks))) {
+        wordIndex->build(tasks);
+        wordIndexChanged = true;
+    }
+    wordIndexReady = true;
+    return true;
+}
+
+
+void TaskList::saveWordIndex() {
+    /*
+    This function writes the word index to indexFile if it has changed,
+    so the next load can map it instead of rebuilding it.
+    */
+    if (!wordIndexReady || !wordIndexChanged) return;
+    std::string buffer;
+    wordIndex->serialize(contentChecksum(tasks), buffer);
+    if (replaceFile(indexFile, buffer, durability)) wordIndexChanged = false;
+}
+
+
+size_t renderTaskWindow(TaskStore::const_iterator& it, const TaskStore::const_iterator& end,
+                        size_t count, std::string& out) {
+    /*
+    This function appends one "[x] id: description" line for each of the
+    next count tasks to out. It moves it past them and returns how many
+    lines it wrote. out grows once, then every row is formatted in place.
+    */
+    size_t room = 0;
+    size_t shown = 0;
+    for (TaskStore::const_iterator sizing = it; shown < count && sizing != end; ++sizing, shown++) {
+        room += TASK_ROW_OVERHEAD + (*sizing).getDescription().size();
+    }
+
+    size_t start = out.size();
+    out.resize(start + room);
+    char* cursor = &out[0] + start;
+    for (size_t i = 0; i < shown; ++it, i++) cursor = formatTaskRow(*it, cursor);
+    out.resize(cursor - out.data());
+    return shown;
+}
+
+
+char* formatTaskRow(const Task& task, char* out) {
+    /*
+    This function writes one "[x] id: description" line to out and returns
+    the end of it. out must have room for TASK_ROW_OVERHEAD bytes plus the
+    description.
+    */
+    out[0] = '[';
+    out[1] = task.isCompleted() ? 'x' : ' ';
+    out[2] = ']';
+    out[3] = ' ';
+    out = std::to_chars(out + 4, out + 15, task.getId()).ptr;
+    out[0] = ':';
+    out[1] = ' ';
+    std::string_view description = task.getDescription();
+    // std::copy, as an empty description may have no data pointer for memcpy
+    out = std::copy(description.begin(), description.end(), out + 2);
+    *out++ = '\n';
+    return out;
+}
+
+
+void searchTasks(const TaskStore& tasks, std::string_view needle, std::vector<int>& matches) {
+    /*
+    This function appends the id of every task whose description contains
+    needle to matches, in list order.
+    */
+    for (const Task& task : tasks) {
+        std::string_view description = task.getDescription();
+        if (findSubstring(description.data(), description.size(), needle.data(), needle.size()) != NOT_FOUND) {
+            matches.push_back(task.getId());
+        }
+    }
+}
+
+
+size_t replayJournal(TaskStore& tasks, const std::string& path) {
+    /*
+    This function applies the records of a journal file to the task store
+    and returns how many records it read.
+    Records are idempotent, so replaying a journal twice gives the same result.
+    */
+    MappedFile file(path);
+    const char* end = file.data() + file.size();
+    const char* line = file.data();
+
+    size_t records = 0;
+    while (line < end) {
+        const char* lineEnd = static_cast<const char*>(std::memchr(line, '\n', end - line));
+        if (!lineEnd) lineEnd = end;
+        const char* next = lineEnd + 1;
+        records++;
+
+        // Split line into op, id and payload (the payload may contain '|')
+        const char* idEnd = nullptr;
+        if (lineEnd - line >= 3 && line[1] == '|') {
+            idEnd = static_cast<const char*>(std::memchr(line + 2, '|', lineEnd - line - 2));
+        }
+        int id;
+        if (!idEnd || !parseId(line + 2, idEnd, id)) {
+            line = next;
+            continue;
+        }
+
+        char op = line[0];
+        std::string_view payload(idEnd + 1, lineEnd - idEnd - 1);
+        line = next;
+
+        switch (op) {
+            case JOURNAL_ADD:
+                if (!tasks.setDescription(id, payload)) tasks.add(Task(id, payload, false));
+                break;
+            case JOURNAL_COMPLETE:
+                tasks.setCompleted(id, payload == "1");
+                break;
+            case JOURNAL_EDIT:
+                tasks.setDescription(id, payload);
+                break;
+            case JOURNAL_DELETE:
+                tasks.remove(id);
+                break;
+        }
+    }
+    return records;
+}
+
+
+bool readSnapshot(TaskStore& tasks, const std::string& path, SnapshotFormat& format) {
+    /*
+    This function reads the tasks from a snapshot file of either format,
+    sets format to the one it found (unchanged if there is no file) and
+    reports success. A damaged binary snapshot adds no tasks and fails.
+    */
+    // Map the file; if it does not exist there is no snapshot yet
+    MappedFile file(path);
+    if (file.size() == 0) return true;
+
+    if (isBinarySnapshot(file.data(), file.size())) {
+        format = SnapshotFormat::Binary;
+        SnapshotChunk chunk;
+        if (!parseBinarySnapshot(chunk, file.data(), file.size())) return false;
+        tasks.addAll(chunk.tasks, chunk.highestId);
+        return true;
+    }
+    format = SnapshotFormat::Text;
+
+    unsigned threads = std::thread::hardware_concurrency();
+    if (file.size() < PARALLEL_LOAD_MIN_SIZE || threads < 2) threads = 1;
+    std::vector<SnapshotChunk> chunks = parseSnapshotChunks(file.data(), file.size(), threads);
+
+    // Chunks are merged in file order, which is id order for files this app writes
+    size_t total = 0;
+    for (const SnapshotChunk& chunk : chunks) total += chunk.tasks.size();
+    tasks.reserve(tasks.size() + total);
+    for (SnapshotChunk& chunk : chunks) tasks.addAll(chunk.tasks, chunk.highestId);
+    return true;
+}
+
+
+bool isBinarySnapshot(const char* data, size_t size) {
+    /*
+    This function checks whether a snapshot starts with the binary magic.
+    A text snapshot never does, because its lines start with a numeric id.
+    */
+    return size >= sizeof(BINARY_MAGIC) && std::memcmp(data, BINARY_MAGIC, sizeof(BINARY_MAGIC)) == 0;
+}
+
+
+bool parseBinarySnapshot(SnapshotChunk& chunk, const char* data, size_t size) {
+    /*
+    This function reads the tasks of a binary snapshot straight from the file bytes.
+    The layout is described in formatBinarySnapshot. Every size and offset is
+    checked against the file, and a damaged or unknown snapshot is rejected whole.
+    */
+    BinarySnapshotHeader header;
+    if (size < sizeof(header)) return false;
+    std::memcpy(&header, data, sizeof(header));
+    if (header.version != BINARY_VERSION) return false;
+
+    // Each task takes 8 (offset) + 4 (id) + 1 (flags) bytes of columns
+    size_t columns = size - sizeof(header);
+    if (header.count > columns / 13) return false;
+    size_t count = static_cast<size_t>(header.count);
+    size_t columnBytes = (count + 1) * sizeof(uint64_t) + count * (sizeof(int32_t) + 1);
+    if (columnBytes > columns || header.blobSize != columns - columnBytes) return false;
+
+    const char* offsets = data + sizeof(header);
+    const char* ids = offsets + (count + 1) * sizeof(uint64_t);
+    const char* flags = ids + count * sizeof(int32_t);
+    const char* blob = flags + count;
+
+    chunk.tasks.reserve(chunk.tasks.size() + count);
+    uint64_t start;
+    std::memcpy(&start, offsets, sizeof(start));
+    for (size_t i = 0; i < count; i++) {
+        uint64_t end;
+        int32_t id;
+        std::memcpy(&end, offsets + (i + 1) * sizeof(uint64_t), sizeof(end));
+        std::memcpy(&id, ids + i * sizeof(int32_t), sizeof(id));
+        if (start > end || end > header.blobSize) {
+            chunk.tasks.clear();
+            return false;
+        }
+        std::string_view description(blob + start, end - start);
+        chunk.tasks.push_back(Task(id, description, (flags[i] & 1) != 0));
+        chunk.highestId = std::max(chunk.highestId, static_cast<int>(id));
+        start = end;
+    }
+    return true;
+}
+
+
+std::vector<SnapshotChunk> parseSnapshotChunks(const char* data, size_t size, unsigned threads) {
+    /*
+    This function splits a snapshot into one newline-aligned chunk per thread
+    and parses the chunks in parallel. Each chunk also tracks its own highest
+    id, so the caller only has to combine one value per chunk.
+    */
+    std::vector<SnapshotChunk> chunks(threads);
+    if (threads == 1) {
+        parseSnapshot(chunks[0], data, size);
+        return chunks;
+    }
+
+    // Move each split point forward to the start of the next line
+    std::vector<const char*> bounds(threads + 1, data + size);
+    bounds[0] = data;
+    for (unsigned i = 1; i < threads; i++) {
+        const char* split = std::max(bounds[i - 1], data + size / threads * i);
+        const char* newline = static_cast<const char*>(std::memchr(split, '\n', data + size - split));
+        bounds[i] = newline ? newline + 1 : data + size;
+    }
+
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < threads; i++) {
+        workers.emplace_back([&chunks, &bounds, i]() {
+            parseSnapshot(chunks[i], bounds[i], bounds[i + 1] - bounds[i]);
+        });
+    }
+    for (std::thread& worker : workers) worker.join();
+    return chunks;
+}
+
+
+void parseSnapshot(SnapshotChunk& chunk, const char* data, size_t size) {
+    /*
+    This function parses snapshot records straight from the file bytes.
+    scanDelimiters finds every '\n' and '|' one block at a time; a line
+    may start in one block and end in the next.
+    */
+    std::vector<uint32_t> offsets(SCAN_BLOCK_SIZE);
+    const char* line = data;
+    const char* firstPipe = nullptr;
+    const char* lastPipe = nullptr;
+
+    for (size_t pos = 0; pos < size; pos += SCAN_BLOCK_SIZE) {
+        const char* block = data + pos;
+        size_t count = scanDelimiters(block, std::min(SCAN_BLOCK_SIZE, size - pos), offsets.data());
+
+        for (size_t i = 0; i < count; i++) {
+            const char* delimiter = block + offsets[i];
+            if (*delimiter == '|') {
+                if (!firstPipe) firstPipe = delimiter;
+                lastPipe = delimiter;
+            } else {
+                parseSnapshotRecord(chunk, line, firstPipe, lastPipe, delimiter);
+                line = delimiter + 1;
+                firstPipe = nullptr;
+                lastPipe = nullptr;
+            }
+        }
+    }
+
+    // The last line may not end with a newline
+    if (line < data + size) parseSnapshotRecord(chunk, line, firstPipe, lastPipe, data + size);
+}
+
+
+void parseSnapshotRecord(SnapshotChunk& chunk, const char* line, const char* firstPipe,
+                         const char* lastPipe, const char* lineEnd) {
+    /*
+    This function adds the task stored on one snapshot line.
+    Each task is expected to be in the format: id|description|completed
+    The description may contain '|', so completed follows the last one.
+    Malformed lines are skipped.
+    */
+    int id;
+    if (!firstPipe || lastPipe == firstPipe || !parseId(line, firstPipe, id)) return;
+
+    bool completed = (lastPipe + 1 < lineEnd && lastPipe[1] == '1'); // Convert completed to bool
+    // The description still points into the file; TaskStore copies it
+    chunk.tasks.push_back(Task(id, std::string_view(firstPipe + 1, lastPipe - firstPipe - 1), completed));
+    chunk.highestId = std::max(chunk.highestId, id);
+}
+
+
+bool parseId(const char* first, const char* last, int& id) {
+    /*
+    This function converts the characters in [first, last) to a task id.
+    */
+    auto result = std::from_chars(first, last, id);
+    return result.ec == std::errc() && result.ptr == last;
+}
+
+
+bool writeSnapshot(const TaskStore& tasks, const std::string& path, SnapshotFormat format,
+                   Durability durability) {
+    /*
+    This function replaces a snapshot file with the tasks in the given format
+    and reports success. The whole snapshot is formatted in memory first
+    and written with a single write.
+    */
+    std::string buffer;
+    if (format == SnapshotFormat::Binary) formatBinarySnapshot(tasks, buffer);
+    else formatTextSnapshot(tasks, buffer);
+    return replaceFile(path, buffer, durability);
+}
+
+
+void formatTextSnapshot(const TaskStore& tasks, std::string& buffer) {
+    /*
+    This function formats the tasks as a text snapshot into buffer.
+    */
+    // Room for the longest possible id, two '|', the flag and '\n' per task
+    size_t capacity = 0;
+    for (const Task& task : tasks) capacity += task.getDescription().size() + 15;
+    buffer.resize(capacity);
+
+    char* out = &buffer[0];
+    for (const Task& task : tasks) {
+        out = std::to_chars(out, out + 11, task.getId()).ptr;
+        *out++ = '|';
+        std::string_view description = task.getDescription();
+        // std::copy, as an empty description may have no data pointer for memcpy
+        out = std::copy(description.begin(), description.end(), out);
+        *out++ = '|';
+        *out++ = task.isCompleted() ? '1' : '0';
+        *out++ = '\n';
+    }
+    buffer.resize(out - buffer.data());
+}
+
+
+void formatBinarySnapshot(const TaskStore& tasks, std::string& buffer) {
+    /*
+    This function formats the tasks as a binary snapshot into buffer.
+    After the header come four columns:
+      uint64 offsets[count + 1]  where each description starts in the blob
+      int32  ids[count]
+      uint8  flags[count]        bit 0 is the completed flag
+      char   blob[blobSize]      all descriptions back to back
+    */
+    uint64_t count = tasks.size();
+    uint64_t blobSize = 0;
+    for (const Task& task : tasks) blobSize += task.getDescription().size();
+
+    BinarySnapshotHeader header;
+    std::memcpy(header.magic, BINARY_MAGIC, sizeof(header.magic));
+    header.version = BINARY_VERSION;
+    header.reserved = 0;
+    header.count = count;
+    header.blobSize = blobSize;
+
+    buffer.resize(sizeof(header) + (count + 1) * sizeof(uint64_t) +
+                  count * (sizeof(int32_t) + 1) + blobSize);
+    char* offsets = &buffer[0] + sizeof(header);
+    char* ids = offsets + (count + 1) * sizeof(uint64_t);
+    char* flags = ids + count * sizeof(int32_t);
+    char* blob = flags + count;
+    std::memcpy(&buffer[0], &header, sizeof(header));
+
+    uint64_t offset = 0;
+    std::memcpy(offsets, &offset, sizeof(offset));
+    size_t i = 0;
+    for (const Task& task : tasks) {
+        std::string_view description = task.getDescription();
+        std::copy(description.begin(), description.end(), blob + offset);
+        offset += description.size();
+        int32_t id = task.getId();
+        std::memcpy(offsets + (i + 1) * sizeof(uint64_t), &offset, sizeof(offset));
+        std::memcpy(ids + i * sizeof(int32_t), &id, sizeof(id));
+        flags[i] = task.isCompleted() ? 1 : 0;
+        i++;
+    }
+}
+
+
+bool replaceFile(const std::string& path, const std::string& contents, Durability durability) {
+    /*
+    This function replaces the file at path with contents and reports success.
+    The contents go to a temp file in the same directory, which is then
+    renamed over path, so a crash leaves either the old file or the new one.
+    durability decides what is synced to disk along the way.
+    */
+    std::string temp = path + TEMP_SUFFIX;
+#if defined(_WIN32)
+    // Windows has no fdatasync; the rename still keeps the file whole
+    std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) return false;
+    file.write(contents.data(), contents.size());
+    file.close();
+    if (file.fail()) return false;
+#else
+    int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    bool ok = writeAll(fd, contents.data(), contents.size());
+    if (ok && durability != Durability::None) ok = syncFileData(fd);
+    ok = (::close(fd) == 0) && ok;
+    if (!ok) {
+        ::unlink(temp.c_str());
+        return false;
+    }
+#endif
+
+    std::error_code ec;
+    std::filesystem::rename(temp, path, ec);
+    if (ec) return false;
+    return durability != Durability::Full || syncDirectory(path);
+}
+
+
+bool writeAll(int fd, const char* data, size_t size) {
+    /*
+    This function writes size bytes to fd and reports success.
+    write may stop early (e.g. on a signal), so it loops until everything is out.
+    */
+#if defined(_WIN32)
+    return false; // Only used on POSIX
+#else
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+#endif
+}
+
+
+bool syncFileData(int fd) {
+    /*
+    This function flushes the data of an open file to disk.
+    */
+#if defined(_WIN32)
+    return true; // Windows has no fdatasync
+#elif defined(__APPLE__)
+    return ::fsync(fd) == 0; // macOS has no fdatasync
+#else
+    return ::fdatasync(fd) == 0;
+#endif
+}
+
+
+bool syncDirectory(const std::string& path) {
+    /*
+    This function fsyncs the directory that holds path, which makes a
+    rename in it durable.
+    */
+#if defined(_WIN32)
+    return true; // Windows cannot open a directory for syncing
+#else
+    std::string directory = std::filesystem::path(path).parent_path().string();
+    if (directory.empty()) directory = ".";
+    int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0) return false;
+    bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+#endif
+}
+
+
+bool convertSnapshot(SnapshotFormat format, const std::string& input, const std::string& output,
+                     Durability durability) {
+    /*
+    This function reads a snapshot of either format and writes it to output
+    in the given format. output may be the same file as input.
+    */
+    TaskStore tasks;
+    SnapshotFormat found = format;
+    if (!readSnapshot(tasks, input, found)) return false;
+    return writeSnapshot(tasks, output, format, durability);
+}
+
+
+bool parseSnapshotFormat(const std::string& name, SnapshotFormat& format) {
+    /*
+    This function turns a format name from the command line into a SnapshotFormat.
+    */
+    if (name == "text") format = SnapshotFormat::Text;
+    else if (name == "binary") format = SnapshotFormat::Binary;
+    else return false;
+    return true;
+}
+
+
+bool parseDurability(const std::string& name, Durability& mode) {
+    /*
+    This function turns a durability name from the command line into a Durability.
+    */
+    if (name == "none") mode = Durability::None;
+    else if (name == "data") mode = Durability::Data;
+    else if (name == "full") mode = Durability::Full;
+    else return false;
+    return true;
+}
+
+
+bool parseCount(const std::string& text, size_t& count) {
+    /*
+    This function converts a non-negative number from the command line.
+    */
+    auto result = std::from_chars(text.data(), text.data() + text.size(), count);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+
+const char* operationName(Operation operation) {
+    /*
+    This function returns the name an operation is reported under.
+    */
+    switch (operation) {
+        case Operation::Load: return "load";
+        case Operation::Save: return "save";
+        case Operation::Add: return "add";
+        case Operation::Toggle: return "toggle";
+        case Operation::Edit: return "edit";
+        case Operation::Delete: return "delete";
+        case Operation::Find: return "find";
+        case Operation::BatchOp: return "batch op";
+        case Operation::Render: return "render";
+        case Operation::Close: return "close";
+        case Operation::Count: break;
+    }
+    return "?";
+}
+
+
+uint64_t contentChecksum(const TaskStore& tasks) {
+    /*
+    This function returns a checksum of the ids and descriptions of the tasks,
+    which is what the word index is built from. Completion flags are left out,
+    so toggling a task does not make the index file stale. The per-task hashes
+    are summed, so the order of the tasks does not matter.
+    */
+    uint64_t sum = 0;
+    for (const Task& task : tasks) {
+        // FNV-1a over the description, then mixed with the id
+        uint64_t hash = 14695981039346656037ULL;
+        for (char c : task.getDescription()) {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ULL;
+        }
+        hash ^= static_cast<uint64_t>(static_cast<uint32_t>(task.getId())) * 0x9E3779B97F4A7C15ULL;
+        hash ^= hash >> 31;
+        hash *= 0xBF58476D1CE4E5B9ULL;
+        hash ^= hash >> 29;
+        sum += hash;
+    }
+    return sum;
+}
+
+
+DelimiterScanner selectDelimiterScanner() {
+    /*
+    This function picks the fastest delimiter scanner the CPU supports.
+    */
+#if TODO_X86
+    if (cpuHasAvx2()) return scanDelimitersAvx2;
+    return scanDelimitersSse2; // SSE2 is part of every x86-64 CPU
+#else
+    return scanDelimitersScalar;
+#endif
+}
+
+
+size_t scanDelimiters(const char* data, size_t size, uint32_t* offsets) {
+    /*
+    This function scans with the kernel picked for this CPU. The pick is made
+    on the first call, not during static initialization, so a TaskList loaded
+    from another file's static initializer still has a kernel to call.
+    */
+    static const DelimiterScanner scanner = selectDelimiterScanner();
+    return scanner(data, size, offsets);
+}
+
+
+size_t scanDelimitersScalar(const char* data, size_t size, uint32_t* offsets) {
+    /*
+    This function finds '\n' and '|' one byte at a time.
+    */
+    size_t count = 0;
+    for (size_t i = 0; i < size; i++) {
+        if (data[i] == '\n' || data[i] == '|') offsets[count++] = static_cast<uint32_t>(i);
+    }
+    return count;
+}
+
+
+#if TODO_X86
+size_t scanDelimitersSse2(const char* data, size_t size, uint32_t* offsets) {
+    /*
+    This function finds '\n' and '|' 16 bytes at a time.
+    */
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i pipe = _mm_set1_epi8('|');
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i matches = _mm_or_si128(_mm_cmpeq_epi8(chunk, newline), _mm_cmpeq_epi8(chunk, pipe));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(matches));
+        // One bit per matching byte
+        while (mask) {
+            offsets[count++] = static_cast<uint32_t>(i + countTrailingZeros(mask));
+            mask &= mask - 1;
+        }
+    }
+    // The tail, shorter than a vector, is scanned from i
+    size_t tail = scanDelimitersScalar(data + i, size - i, offsets + count);
+    for (size_t k = count; k < count + tail; k++) offsets[k] += static_cast<uint32_t>(i);
+    return count + tail;
+}
+
+
+TODO_TARGET_AVX2
+size_t scanDelimitersAvx2(const char* data, size_t size, uint32_t* offsets) {
+    /*
+    This function finds '\n' and '|' 32 bytes at a time.
+    */
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i pipe = _mm256_set1_epi8('|');
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        __m256i matches = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, newline),
+                                          _mm256_cmpeq_epi8(chunk, pipe));
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(matches));
+        // One bit per matching byte
+        while (mask) {
+            offsets[count++] = static_cast<uint32_t>(i + countTrailingZeros(mask));
+            mask &= mask - 1;
+        }
+    }
+    // The tail, shorter than a vector, is scanned from i
+    size_t tail = scanDelimitersScalar(data + i, size - i, offsets + count);
+    for (size_t k = count; k < count + tail; k++) offsets[k] += static_cast<uint32_t>(i);
+    return count + tail;
+}
+
+
+bool cpuHasAvx2() {
+    /*
+    This function asks CPUID whether the CPU and OS support AVX2.
+    */
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    bool osSavesYmm = (info[2] & (1 << 27)) && ((_xgetbv(0) & 6) == 6);
+    __cpuidex(info, 7, 0);
+    return osSavesYmm && (info[1] & (1 << 5));
+#else
+    __builtin_cpu_init(); // May run before other static constructors
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+
+unsigned countTrailingZeros(uint32_t mask) {
+    /*
+    This function returns the index of the lowest set bit (mask must not be 0).
+    */
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+
+unsigned highestBit(uint64_t value) {
+    /*
+    This function returns the index of the highest set bit (value must not be 0).
+    */
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return index;
+#else
+    return 63 - static_cast<unsigned>(__builtin_clzll(value));
+#endif
+}
+
+
+LiveBitCounter selectLiveBitCounter() {
+    /*
+    This function picks the fastest bit counter the CPU supports.
+    */
+#if TODO_X86
+    if (cpuHasPopcnt()) return countLiveBitsPopcnt;
+#endif
+    return countLiveBitsScalar;
+}
+
+
+size_t countLiveBits(const uint64_t* completed, const uint64_t* dead, size_t words) {
+    /*
+    This function counts the bits set in completed but not in dead, with the
+    counter picked for this CPU on the first call.
+    */
+    static const LiveBitCounter counter = selectLiveBitCounter();
+    return counter(completed, dead, words);
+}
+
+
+size_t countLiveBitsScalar(const uint64_t* completed, const uint64_t* dead, size_t words) {
+    /*
+    This function counts bits one word at a time without a popcount instruction.
+    */
+    size_t count = 0;
+    for (size_t i = 0; i < words; i++) {
+        uint64_t word = completed[i] & ~dead[i];
+        // Add up the bits in pairs, then nibbles, then bytes
+        word = word - ((word >> 1) & 0x5555555555555555ULL);
+        word = (word & 0x3333333333333333ULL) + ((word >> 2) & 0x3333333333333333ULL);
+        word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+        count += static_cast<size_t>((word * 0x0101010101010101ULL) >> 56);
+    }
+    return count;
+}
+
+
+#if TODO_X86
+TODO_TARGET_POPCNT
+size_t countLiveBitsPopcnt(const uint64_t* completed, const uint64_t* dead, size_t words) {
+    /*
+    This function counts bits one word at a time with the POPCNT instruction.
+    */
+    size_t count = 0;
+    for (size_t i = 0; i < words; i++) {
+#if defined(_MSC_VER)
+        count += static_cast<size_t>(__popcnt64(completed[i] & ~dead[i]));
+#else
+        count += static_cast<size_t>(__builtin_popcountll(completed[i] & ~dead[i]));
+#endif
+    }
+    return count;
+}
+
+
+bool cpuHasPopcnt() {
+    /*
+    This function asks CPUID whether the CPU has the POPCNT instruction.
+    */
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 23)) != 0;
+#else
+    __builtin_cpu_init(); // May run before other static constructors
+    return __builtin_cpu_supports("popcnt");
+#endif
+}
+#endif
+
+
+SubstringFinder selectSubstringFinder() {
+    /*
+    This function picks the fastest substring finder the CPU supports.
+    */
+#if TODO_X86
+    if (cpuHasAvx2()) return findSubstringAvx2;
+    return findSubstringSse2; // SSE2 is part of every x86-64 CPU
+#else
+    return findSubstringScalar;
+#endif
+}
+
+
+size_t findSubstring(const char* text, size_t size, const char* needle, size_t needleSize) {
+    /*
+    This function searches with the finder picked for this CPU on the first call.
+    */
+    static const SubstringFinder finder = selectSubstringFinder();
+    return finder(text, size, needle, needleSize);
+}
+
+
+size_t findSubstringScalar(const char* text, size_t size, const char* needle, size_t needleSize) {
+    /*
+    This function finds needle in text with std::string_view::find.
+    */
+    size_t position = std::string_view(text, size).find(std::string_view(needle, needleSize));
+    return position == std::string_view::npos ? NOT_FOUND : position;
+}
+
+
+#if TODO_X86
+size_t findSubstringSse2(const char* text, size_t size, const char* needle, size_t needleSize) {
+    /*
+    This function finds needle in text 16 positions at a time. A position
+    is only checked with memcmp when both the first and the last byte of
+    needle match there.
+    */
+    if (needleSize == 0) return 0;
+    if (needleSize > size) return NOT_FOUND;
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[needleSize - 1]);
+    size_t i = 0;
+    for (; i + needleSize - 1 + 16 <= size; i += 16) {
+        __m128i blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+        __m128i blockLast = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i + needleSize - 1));
+        __m128i matches = _mm_and_si128(_mm_cmpeq_epi8(blockFirst, first), _mm_cmpeq_epi8(blockLast, last));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(matches));
+        // One bit per candidate position
+        while (mask) {
+            size_t position = i + countTrailingZeros(mask);
+            if (needleSize <= 2 || std::memcmp(text + position + 1, needle + 1, needleSize - 2) == 0) {
+                return position;
+            }
+            mask &= mask - 1;
+        }
+    }
+    size_t position = findSubstringScalar(text + i, size - i, needle, needleSize);
+    return position == NOT_FOUND ? NOT_FOUND : i + position;
+}
+
+
+TODO_TARGET_AVX2
+size_t findSubstringAvx2(const char* text, size_t size, const char* needle, size_t needleSize) {
+    /*
+    This function finds needle in text 32 positions at a time, the same
+    way as findSubstringSse2.
+    */
+    if (needleSize == 0) return 0;
+    if (needleSize > size) return NOT_FOUND;
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[needleSize - 1]);
+    size_t i = 0;
+    for (; i + needleSize - 1 + 32 <= size; i += 32) {
+        __m256i blockFirst = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + i));
+        __m256i blockLast = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + i + needleSize - 1));
+        __m256i matches = _mm256_and_si256(_mm256_cmpeq_epi8(blockFirst, first),
+                                           _mm256_cmpeq_epi8(blockLast, last));
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(matches));
+        // One bit per candidate position
+        while (mask) {
+            size_t position = i + countTrailingZeros(mask);
+            if (needleSize <= 2 || std::memcmp(text + position + 1, needle + 1, needleSize - 2) == 0) {
+                return position;
+            }
+            mask &= mask - 1;
+        }
+    }
+    size_t position = findSubstringScalar(text + i, size - i, needle, needleSize);
+    return position == NOT_FOUND ? NOT_FOUND : i + position;
+}
+#endif
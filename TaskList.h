@@ -0,0 +1,766 @@
+/*
+============================================
+ TODO Task Engine
+============================================
+
+ Description:
+   The task list behind the TODO CLI, with
+   no console input or output, so it can be
+   linked into other front ends and run
+   headless in benchmarks. TaskList adds,
+   toggles, edits, removes and finds tasks
+   and keeps them on disk.
+
+ File Format:
+   tasks.txt stores each task in the format:
+   id|description|completed
+   Example:
+   1|Take out trash|0
+   2|Finish C++ project|1
+
+   Every change after loading is appended to
+   tasks.journal as one record per line:
+   op|id|payload
+   where op is A (add), C (set completed),
+   E (edit) or D (delete). On load the
+   journal is replayed on top of tasks.txt.
+   Once the journal grows large it is folded
+   into a new tasks.txt on a background thread.
+
+   tasks.txt may instead hold a binary snapshot
+   (see BINARY_MAGIC). The format is detected
+   on load, and later snapshots keep it.
+
+   Snapshots are written to a temp file and
+   renamed over tasks.txt, so a crash leaves
+   either the old or the new list. How hard
+   each save syncs to disk is set by
+   Durability. Journal records are
+   group-committed: those arriving within a
+   few milliseconds of each other are written
+   and synced together.
+
+   With the word index on, it is saved to
+   tasks.index on close. The next TaskList
+   maps it instead of rebuilding it, unless
+   the tasks have changed in between.
+
+============================================
+*/
+
+#ifndef TODO_TASKLIST_H
+#define TODO_TASKLIST_H
+
+// Built with TODO_TRACK_ALLOCATIONS=1 (cmake -DTODO_TRACK_ALLOCATIONS=ON),
+// operator new is replaced to count heap use per Operation. Every file
+// that includes this one must see the same value.
+#ifndef TODO_TRACK_ALLOCATIONS
+#define TODO_TRACK_ALLOCATIONS 0
+#endif
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <unordered_map>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <cstdint>
+#include <chrono>
+
+class Task {
+private:
+    static int nextId;
+    int id;
+    // Points at text owned by someone else: the TaskStore arena once the
+    // task is added, or the caller's buffer (e.g. a mapped file) until then
+    std::string_view description;
+    bool completed;
+
+public:
+    // Constructor with initializer list
+    Task(std::string_view description)
+        : id(nextId++), description(description), completed(false) {}
+
+    // Constructor for tasks restored from disk (does not touch nextId)
+    Task(int id, std::string_view description, bool completed)
+        : id(id), description(description), completed(completed) {}
+
+    // Getters
+    static int getNextId() {
+        return nextId;
+    }
+    int getId() const {
+        return id;
+    }
+    std::string_view getDescription() const {
+        return description;
+    }
+    bool isCompleted() const {
+        return completed;
+    }
+
+    // Setters
+    static void setNextId(int id) {
+        nextId = id;
+    }
+    void setId(int id) {
+        this->id = id;
+    }
+    // Only stores the view; use TaskStore::setDescription to copy the text
+    void setDescription(std::string_view description) {
+        this->description = description;
+    }
+    void setCompleted(bool completed) {
+        this->completed = completed;
+    }
+};
+
+
+class StringArena {
+private:
+    static constexpr size_t BLOCK_SIZE = 1024 * 1024;
+    // Blocks never move, so views into them stay valid until the arena is destroyed
+    std::vector<std::unique_ptr<char[]>> blocks;
+    char* cursor = nullptr;
+    size_t remaining = 0;
+    size_t used = 0;
+
+    void newBlock(size_t size) {
+        blocks.emplace_back(new char[size]);
+        cursor = blocks.back().get();
+        remaining = size;
+    }
+
+public:
+    // Makes room for at least bytes more text in the current block
+    void reserve(size_t bytes) {
+        if (bytes > remaining) newBlock(bytes);
+    }
+
+    // Copies text into the arena and returns a view of the copy
+    std::string_view store(std::string_view text) {
+        if (text.empty()) return std::string_view();
+        if (text.size() > remaining) newBlock(std::max(BLOCK_SIZE, text.size()));
+        std::memcpy(cursor, text.data(), text.size());
+        std::string_view copy(cursor, text.size());
+        cursor += text.size();
+        remaining -= text.size();
+        used += text.size();
+        return copy;
+    }
+
+    // Bytes of text stored so far
+    size_t size() const {
+        return used;
+    }
+};
+
+
+// Counts the bits set in completed but not in dead over the given words
+size_t countLiveBits(const uint64_t* completed, const uint64_t* dead, size_t words);
+
+
+class BitColumn {
+private:
+    // 64 flags per word; bits past size() are always 0
+    std::vector<uint64_t> words;
+    size_t bits = 0;
+
+public:
+    bool operator[](size_t index) const {
+        return (words[index / 64] >> (index % 64)) & 1;
+    }
+    void set(size_t index, bool value) {
+        uint64_t mask = uint64_t(1) << (index % 64);
+        if (value) words[index / 64] |= mask;
+        else words[index / 64] &= ~mask;
+    }
+    void push_back(bool value) {
+        if (bits % 64 == 0) words.push_back(0);
+        set(bits++, value);
+    }
+    // Shrinks or grows to count flags; new flags are false
+    void resize(size_t count) {
+        words.resize((count + 63) / 64, 0);
+        bits = count;
+        if (count % 64) words.back() &= (uint64_t(1) << (count % 64)) - 1;
+    }
+    void assign(size_t count, bool value) {
+        words.assign((count + 63) / 64, value ? ~uint64_t(0) : 0);
+        bits = count;
+        if (value && count % 64) words.back() = (uint64_t(1) << (count % 64)) - 1;
+    }
+    void reserve(size_t count) {
+        words.reserve((count + 63) / 64);
+    }
+    size_t size() const {
+        return bits;
+    }
+    const uint64_t* data() const {
+        return words.data();
+    }
+    size_t wordCount() const {
+        return words.size();
+    }
+};
+
+
+class TaskStore {
+private:
+    static constexpr int NO_SLOT = -1;
+    // Deleted tasks stay in their slot as tombstones until enough of them
+    // pile up, then the columns are compacted in one pass
+    static constexpr size_t COMPACT_MIN_DEAD = 64;
+    static constexpr size_t COMPACT_DEAD_RATIO = 4; // compact when 1/4 are dead
+    // Replaced and deleted descriptions stay in the arena until they make up
+    // half of it, then the live ones are copied to a fresh arena
+    static constexpr size_t COMPACT_MIN_WASTED_BYTES = 1024 * 1024;
+    // Tasks are stored as columns indexed by slot, so a scan over one field
+    // (e.g. completed) only touches that field
+    std::vector<int> ids;
+    std::vector<std::string_view> descriptions; // Views into text
+    // One bit per slot
+    BitColumn completed;
+    BitColumn dead;
+    StringArena text;
+    size_t wastedBytes = 0;
+    size_t deadCount = 0;
+    int highestId = 0;
+    // Maps a task id to its slot. Ids are dense because they come from
+    // Task::nextId, so the table is indexed by id directly.
+    // Ids far outside the table (e.g. from a hand-edited file) go to sparseSlots.
+    std::vector<int> slots;
+    std::unordered_map<int, int> sparseSlots;
+
+    void setSlot(int id, int slot) {
+        if (id >= 0 && (static_cast<size_t>(id) < slots.size() ||
+                        static_cast<size_t>(id) <= 2 * ids.size() + 1024)) {
+            if (static_cast<size_t>(id) >= slots.size()) slots.resize(id + 1, NO_SLOT);
+            slots[id] = slot;
+        } else {
+            sparseSlots[id] = slot;
+        }
+    }
+
+    int getSlot(int id) const {
+        if (id >= 0 && static_cast<size_t>(id) < slots.size() && slots[id] != NO_SLOT)
+            return slots[id];
+        if (sparseSlots.empty()) return NO_SLOT;
+        auto it = sparseSlots.find(id);
+        return it == sparseSlots.end() ? NO_SLOT : it->second;
+    }
+
+    void clearSlot(int id) {
+        if (id >= 0 && static_cast<size_t>(id) < slots.size()) slots[id] = NO_SLOT;
+        sparseSlots.erase(id);
+    }
+
+    // Appends one row to the columns and indexes it; description must already be in text
+    void push(int id, std::string_view description, bool isCompleted) {
+        ids.push_back(id);
+        descriptions.push_back(description);
+        completed.push_back(isCompleted);
+        dead.push_back(false);
+        setSlot(id, static_cast<int>(ids.size() - 1));
+    }
+
+    // Moves live tasks down over the tombstones and reindexes them
+    void compact() {
+        size_t live = 0;
+        for (size_t slot = 0; slot < ids.size(); slot++) {
+            if (dead[slot]) continue;
+            if (live != slot) {
+                ids[live] = ids[slot];
+                descriptions[live] = descriptions[slot];
+                completed.set(live, completed[slot]);
+            }
+            setSlot(ids[live], static_cast<int>(live));
+            live++;
+        }
+        ids.resize(live);
+        descriptions.resize(live);
+        completed.resize(live);
+        dead.assign(live, false);
+        deadCount = 0;
+    }
+
+    // Copies the live descriptions to a fresh arena once enough text is garbage
+    void maybeCompactDescriptions() {
+        if (wastedBytes < COMPACT_MIN_WASTED_BYTES || wastedBytes * 2 < text.size()) return;
+        StringArena fresh;
+        fresh.reserve(text.size() - wastedBytes);
+        for (size_t slot = 0; slot < ids.size(); slot++) {
+            descriptions[slot] = dead[slot] ? std::string_view() : fresh.store(descriptions[slot]);
+        }
+        text = std::move(fresh);
+        wastedBytes = 0;
+    }
+
+public:
+    // Iterates over live tasks in insertion order, skipping tombstones.
+    // Each task is assembled from the columns as a Task value.
+    class const_iterator {
+    private:
+        const TaskStore* store;
+        size_t slot;
+
+        void skipDead() {
+            while (slot < store->ids.size() && store->dead[slot]) slot++;
+        }
+
+    public:
+        const_iterator(const TaskStore* store, size_t slot)
+            : store(store), slot(slot) {
+            skipDead();
+        }
+        Task operator*() const {
+            return Task(store->ids[slot], store->descriptions[slot], store->completed[slot]);
+        }
+        const_iterator& operator++() {
+            slot++;
+            skipDead();
+            return *this;
+        }
+        // Steps back to the previous live task; must not be called on begin()
+        const_iterator& operator--() {
+            do slot--; while (store->dead[slot]);
+            return *this;
+        }
+        bool operator==(const const_iterator& other) const {
+            return slot == other.slot;
+        }
+        bool operator!=(const const_iterator& other) const {
+            return slot != other.slot;
+        }
+    };
+
+    // Adds a task, copying its description into the store, and indexes it by id
+    void add(const Task& task) {
+        push(task.getId(), text.store(task.getDescription()), task.isCompleted());
+        highestId = std::max(highestId, task.getId());
+    }
+
+    // Moves a batch of parsed tasks into the store; chunkHighestId is their largest id
+    void addAll(std::vector<Task>& chunk, int chunkHighestId) {
+        reserve(ids.size() + chunk.size());
+        // Copy every description into one block of the arena
+        size_t bytes = 0;
+        for (const Task& task : chunk) bytes += task.getDescription().size();
+        text.reserve(bytes);
+        for (const Task& task : chunk) {
+            push(task.getId(), text.store(task.getDescription()), task.isCompleted());
+        }
+        chunk.clear();
+        highestId = std::max(highestId, chunkHighestId);
+    }
+
+    // Reports whether a task with the given id exists
+    bool contains(int id) const {
+        return getSlot(id) != NO_SLOT;
+    }
+
+    // Returns an iterator to the task with the given id, or end() if there is none
+    const_iterator findPosition(int id) const {
+        int slot = getSlot(id);
+        return slot == NO_SLOT ? end() : const_iterator(this, slot);
+    }
+
+    // Returns the task's description (empty if there is no such task)
+    std::string_view getDescription(int id) const {
+        int slot = getSlot(id);
+        return slot == NO_SLOT ? std::string_view() : descriptions[slot];
+    }
+
+    // Returns whether the task is completed (false if there is no such task)
+    bool isCompleted(int id) const {
+        int slot = getSlot(id);
+        return slot != NO_SLOT && completed[slot];
+    }
+
+    // Sets the completed flag and reports whether the task exists
+    bool setCompleted(int id, bool isCompleted) {
+        int slot = getSlot(id);
+        if (slot == NO_SLOT) return false;
+        completed.set(slot, isCompleted);
+        return true;
+    }
+
+    // Gives a task a new description and reports whether the task exists.
+    // The text is copied into the arena; the old copy stays there until
+    // the arena is compacted.
+    bool setDescription(int id, std::string_view description) {
+        int slot = getSlot(id);
+        if (slot == NO_SLOT) return false;
+        wastedBytes += descriptions[slot].size();
+        descriptions[slot] = text.store(description);
+        maybeCompactDescriptions();
+        return true;
+    }
+
+    // Removes the task with the given id and reports whether it existed
+    bool remove(int id) {
+        int slot = getSlot(id);
+        if (slot == NO_SLOT) return false;
+        clearSlot(id);
+        dead.set(slot, true);
+        deadCount++;
+        wastedBytes += descriptions[slot].size();
+        if (deadCount >= COMPACT_MIN_DEAD && deadCount * COMPACT_DEAD_RATIO >= ids.size()) {
+            compact();
+        }
+        maybeCompactDescriptions();
+        return true;
+    }
+
+    void reserve(size_t count) {
+        ids.reserve(count);
+        descriptions.reserve(count);
+        completed.reserve(count);
+        dead.reserve(count);
+    }
+    // Largest id ever added, including deleted tasks
+    int getHighestId() const {
+        return highestId;
+    }
+    bool empty() const {
+        return size() == 0;
+    }
+    size_t size() const {
+        return ids.size() - deadCount;
+    }
+    // Number of live completed tasks, counted a word of flags at a time
+    size_t countCompleted() const {
+        return countLiveBits(completed.data(), dead.data(), completed.wordCount());
+    }
+
+    const_iterator begin() const {
+        return const_iterator(this, 0);
+    }
+    const_iterator end() const {
+        return const_iterator(this, ids.size());
+    }
+};
+
+
+class MappedFile {
+private:
+    const char* bytes = nullptr;
+    size_t length = 0;
+    bool opened = false;
+#if defined(_WIN32)
+    std::string buffer; // Windows reads the file into memory instead
+#endif
+
+public:
+    // Maps the whole file read-only; isOpen() is false if it does not exist
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Getters
+    bool isOpen() const {
+        return opened;
+    }
+    const char* data() const {
+        return bytes;
+    }
+    size_t size() const {
+        return length;
+    }
+};
+
+
+// On-disk layouts a snapshot can be written in
+enum class SnapshotFormat {
+    Text,   // id|description|completed, one task per line
+    Binary  // BinarySnapshotHeader followed by columns (see formatBinarySnapshot)
+};
+
+
+// How far a save goes to make sure the data reaches the disk
+enum class Durability {
+    None,  // Leave flushing to the OS
+    Data,  // fdatasync the new file before it is renamed into place
+    Full   // Data, then fsync the directory so renames and new journal files survive a crash
+};
+
+
+// A batch line that TaskList::applyBatch could not apply
+struct RejectedLine {
+    size_t number;         // Counting from 1
+    std::string_view text; // Points into the batch
+};
+
+
+// What OperationScope times into a LatencyProfile and, in allocation-tracking
+// builds, counts heap use against
+enum class Operation {
+    Load,
+    Save,
+    Add,
+    Toggle,
+    Edit,
+    Delete,
+    Find,
+    BatchOp, // One line of TaskList::applyBatch
+    Render,  // Formatting a list for the console (timed by the front end)
+    Close,
+    Count    // Not an operation: how many there are
+};
+
+
+// Counts latencies in log-linear buckets, the way HdrHistogram does: each
+// power of two is split into SUB_BUCKETS equal buckets, so a value is
+// reported at most 1/SUB_BUCKETS (about 3%) above what was recorded over
+// the whole 64-bit range, and recording is a few shifts and an increment.
+class LatencyHistogram {
+private:
+    static constexpr unsigned SUB_BUCKET_BITS = 5;
+    static constexpr size_t SUB_BUCKETS = size_t(1) << SUB_BUCKET_BITS;
+    // 0..63 get a bucket each, then every power of two up to 2^63 gets SUB_BUCKETS
+    static constexpr size_t BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    uint64_t counts[BUCKET_COUNT] = {};
+    uint64_t total = 0;
+    uint64_t max = 0;
+
+    static size_t bucketOf(uint64_t nanoseconds);
+    static uint64_t highestValueIn(size_t bucket);
+
+public:
+    void record(uint64_t nanoseconds);
+
+    // The smallest recorded latency that percentile percent of the
+    // recordings are at or below (0 when empty)
+    uint64_t valueAtPercentile(double percentile) const;
+
+    // Getters
+    uint64_t getCount() const {
+        return total;
+    }
+    uint64_t getMax() const {
+        return max;
+    }
+};
+
+
+// A latency histogram for every Operation. Timing is opt-in: whoever
+// times an operation holds a LatencyProfile pointer that is null when it
+// is off, and then does not read the clock at all.
+class LatencyProfile {
+private:
+    LatencyHistogram histograms[static_cast<size_t>(Operation::Count)];
+
+public:
+    void record(Operation operation, std::chrono::steady_clock::duration elapsed) {
+        histograms[static_cast<size_t>(operation)].record(
+            static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    }
+
+    // Getters
+    const LatencyHistogram& get(Operation operation) const {
+        return histograms[static_cast<size_t>(operation)];
+    }
+};
+
+
+#if TODO_TRACK_ALLOCATIONS
+// Heap use counted against one Operation
+struct AllocationCount {
+    uint64_t operations;  // How many scopes of it ended
+    uint64_t allocations;
+    uint64_t bytes;
+};
+
+// The operation this thread is inside, or Operation::Count outside any.
+// operator new counts each allocation against it.
+extern thread_local Operation currentOperation;
+
+void countOperation(Operation operation);
+// Operation::Count gives the heap use outside any operation
+AllocationCount getAllocationCount(Operation operation);
+#endif
+
+
+// Marks the scope it lives in as one operation: times it if profile is
+// not null, and in allocation-tracking builds counts its heap use
+class OperationScope {
+private:
+    LatencyProfile* profile;
+    Operation operation;
+    std::chrono::steady_clock::time_point start;
+#if TODO_TRACK_ALLOCATIONS
+    Operation outer; // Nested scopes count against the innermost
+#endif
+
+public:
+    OperationScope(LatencyProfile* profile, Operation operation)
+        : profile(profile), operation(operation) {
+#if TODO_TRACK_ALLOCATIONS
+        outer = currentOperation;
+        currentOperation = operation;
+#endif
+        if (profile) start = std::chrono::steady_clock::now();
+    }
+    ~OperationScope() {
+        if (profile) profile->record(operation, std::chrono::steady_clock::now() - start);
+#if TODO_TRACK_ALLOCATIONS
+        countOperation(operation);
+        currentOperation = outer;
+#endif
+    }
+
+    OperationScope(const OperationScope&) = delete;
+    OperationScope& operator=(const OperationScope&) = delete;
+};
+
+
+class JournalWriter;
+class WordIndex;
+
+
+// The tasks and everything that keeps them on disk: the snapshot, the
+// journal of changes since, its background compaction and the optional
+// word index. Nothing here reads from or writes to the console.
+class TaskList {
+private:
+    TaskStore tasks;
+
+    // The snapshot and the files kept next to it
+    std::string tasksFile;
+    std::string journalFile;
+    std::string compactingFile; // The journal while it is being compacted
+    std::string indexFile;
+
+    // Format of the snapshot, detected on load and kept by every later snapshot
+    SnapshotFormat snapshotFormat = SnapshotFormat::Text;
+    Durability durability = Durability::Full;
+    // The snapshot could not be read, so it must not be written over
+    bool snapshotUnreadable = false;
+
+    // Opened on the first change
+    std::unique_ptr<JournalWriter> journal;
+
+    // Size of the current journal, and the size that starts a compaction
+    size_t journalRecords = 0;
+    std::uintmax_t journalBytes = 0;
+    size_t compactRecordLimit;
+    std::uintmax_t compactByteLimit;
+
+    // Background compaction state
+    std::thread compactionThread;
+    std::atomic<bool> compactionRunning{false};
+
+    // Optional word index for find (see setWordIndex)
+    std::unique_ptr<WordIndex> wordIndex;
+    bool useWordIndex = false;
+    bool wordIndexReady = false;
+    bool wordIndexChanged = false; // Differs from indexFile
+
+    // Latency of each operation, while profiling is on
+    std::unique_ptr<LatencyProfile> profile;
+
+    void appendJournalRecord(char op, int id, std::string_view payload);
+    void maybeCompactJournal();
+    void compactJournal(SnapshotFormat format);
+    void finishCompaction();
+    bool prepareWordIndex();
+    void saveWordIndex();
+    bool applyBatchOp(const char* line, const char* lineEnd);
+
+public:
+    // The journal and index files are named after tasksFile
+    // (tasks.txt -> tasks.journal, tasks.index)
+    explicit TaskList(const std::string& tasksFile = "tasks.txt");
+    ~TaskList();
+
+    TaskList(const TaskList&) = delete;
+    TaskList& operator=(const TaskList&) = delete;
+
+    // Sets how saves and journal records are synced, and how journal
+    // records are grouped. Call before the first change.
+    void configure(Durability durability, std::chrono::milliseconds commitWindow, size_t commitRecords);
+    // With the word index on, find matches whole words through an index
+    // instead of scanning for a substring
+    void setWordIndex(bool enabled);
+    // With profiling on, the latency of every operation is recorded in
+    // getProfile(). Turning it off drops what was recorded.
+    void setProfiling(bool enabled);
+    // The journal is compacted once it holds this many records or bytes
+    // (COMPACT_RECORD_LIMIT and COMPACT_BYTE_LIMIT by default)
+    void setCompactionLimits(size_t records, std::uintmax_t bytes);
+
+    // Returns false if the snapshot is damaged. The tasks are then left
+    // empty and save() refuses to write over the snapshot.
+    bool load();
+    bool save();
+    // Commits the journal, waits for compaction and saves the word index.
+    // The destructor does this too. Returns false if a journal write has
+    // failed since the last save: the changes from then on are only in
+    // memory, and save() is the way to keep them.
+    bool close();
+
+    // Each change is applied and recorded in the journal. A description
+    // holds one line: journal records and text snapshots are split at
+    // '\n', so add returns -1 and edit returns false if it contains one.
+    int add(std::string_view description);
+    bool toggle(int id);
+    bool edit(int id, std::string_view description);
+    bool remove(int id);
+
+    // Leaves the ids of the matching tasks in matches, in list order
+    void find(std::string_view text, std::vector<int>& matches);
+
+    // Applies a batch of ops, one per line, without journaling them; save()
+    // afterwards to keep them. Returns how many lines it rejected.
+    size_t applyBatch(const char* data, size_t size, std::vector<RejectedLine>& rejected);
+
+    // Getters
+    const TaskStore& getTasks() const {
+        return tasks;
+    }
+    bool usesWordIndex() const {
+        return useWordIndex;
+    }
+    // Null unless profiling is on; the front end records Render into it
+    LatencyProfile* getProfile() const {
+        return profile.get();
+    }
+};
+
+
+/*
+====== Function declarations ======
+*/
+size_t renderTaskWindow(TaskStore::const_iterator& it, const TaskStore::const_iterator& end,
+                        size_t count, std::string& out);
+char* formatTaskRow(const Task& task, char* out);
+bool writeSnapshot(const TaskStore& tasks, const std::string& path, SnapshotFormat format,
+                   Durability durability);
+bool convertSnapshot(SnapshotFormat format, const std::string& input, const std::string& output,
+                     Durability durability);
+bool parseSnapshotFormat(const std::string& name, SnapshotFormat& format);
+bool parseDurability(const std::string& name, Durability& mode);
+bool parseCount(const std::string& text, size_t& count);
+const char* operationName(Operation operation);
+
+
+// Journal records arriving within GROUP_COMMIT_WINDOW of each other, up to
+// GROUP_COMMIT_RECORDS of them, are written and synced together by default
+const std::chrono::milliseconds GROUP_COMMIT_WINDOW(5);
+const size_t GROUP_COMMIT_RECORDS = 1000;
+
+// The journal is compacted once it holds this many records or bytes by default
+const size_t COMPACT_RECORD_LIMIT = 10000;
+const std::uintmax_t COMPACT_BYTE_LIMIT = 4 * 1024 * 1024;
+
+// Longest task row apart from the description: "[x] " + an 11-digit id + ": " + '\n'
+const size_t TASK_ROW_OVERHEAD = 18;
+
+#endif
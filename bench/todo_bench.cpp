@@ -0,0 +1,614 @@
+/*
+============================================
+ TODO CLI Benchmarks
+============================================
+
+ Description:
+   Benchmarks for the task operations of the
+   TODO CLI, in the style of Google Benchmark.
+   Each benchmark runs at 1K, 100K and 10M
+   tasks and reports:
+     - ns/op      time per operation
+     - allocs/op  heap allocations per operation
+     - bytes/op   heap bytes allocated per operation
+   Snapshots are generated into a scratch
+   directory that is removed afterwards.
+
+ Benchmarks:
+   load/<text|binary>  TaskList::load
+   save/<text|binary>  TaskList::save
+   add                 TaskList::add of a new task
+   toggle              TaskList::toggle of a random id
+   edit                TaskList::edit of a random id
+   delete              TaskList::remove of a random id
+   The four changes go through the journal, as
+   in the app, with group commit on and
+   compaction off.
+   view/page           format one page at a random id
+   view/all            format the whole list
+   find/substring      TaskList::find with the SIMD
+                       substring matcher
+   find/word-index     TaskList::find with the word
+                       index, built before the run
+
+ Compilation:
+   built with the app by CMake, or:
+   clang++ -std=c++17 -O2 -pthread -I. -o todo_bench bench/todo_bench.cpp TaskList.cpp
+
+ Usage:
+   ./todo_bench [--filter <text>] [--sizes <n,n,...>]
+                [--min-time <ms>] [--durability <none|data|full>]
+   ./todo_bench --generate <count> <file> [text|binary]
+     writes a synthetic tasks.txt and exits
+
+============================================
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <limits>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <cstdio>
+#include <random>
+
+#include "TaskList.h"
+#if !TODO_TRACK_ALLOCATIONS
+#include "AllocationHooks.h"
+#endif
+
+class BenchmarkState;
+
+using BenchmarkFunction = void (*)(BenchmarkState& state);
+
+struct Benchmark {
+    const char* name;
+    BenchmarkFunction function;
+};
+
+void runBenchmark(const Benchmark& benchmark, size_t count);
+void generateTasks(TaskStore& tasks, size_t count);
+void loadSyntheticList(TaskList& list, size_t count);
+bool writeSyntheticSnapshot(const std::string& path, size_t count, SnapshotFormat format);
+std::vector<int> randomIds(size_t count, size_t howMany);
+bool parseSizes(const std::string& text, std::vector<size_t>& sizes);
+void printBenchUsage(const char* program);
+void benchLoad(BenchmarkState& state, SnapshotFormat format);
+void benchLoadText(BenchmarkState& state);
+void benchLoadBinary(BenchmarkState& state);
+void benchSave(BenchmarkState& state, SnapshotFormat format);
+void benchSaveText(BenchmarkState& state);
+void benchSaveBinary(BenchmarkState& state);
+void benchAdd(BenchmarkState& state);
+void benchToggle(BenchmarkState& state);
+void benchEdit(BenchmarkState& state);
+void benchDelete(BenchmarkState& state);
+void benchViewPage(BenchmarkState& state);
+void benchViewAll(BenchmarkState& state);
+void benchFind(BenchmarkState& state, bool wordIndex);
+void benchFindSubstring(BenchmarkState& state);
+void benchFindWordIndex(BenchmarkState& state);
+
+
+#if TODO_TRACK_ALLOCATIONS
+// The engine already replaces operator new to count heap use per
+// operation, so its counts are added up instead
+size_t heapAllocations() {
+    size_t total = 0;
+    for (size_t i = 0; i <= static_cast<size_t>(Operation::Count); i++)
+        total += getAllocationCount(static_cast<Operation>(i)).allocations;
+    return total;
+}
+size_t heapBytes() {
+    size_t total = 0;
+    for (size_t i = 0; i <= static_cast<size_t>(Operation::Count); i++)
+        total += getAllocationCount(static_cast<Operation>(i)).bytes;
+    return total;
+}
+#else
+// Heap use so far, counted through AllocationHooks.h
+std::atomic<size_t> allocationCount(0);
+std::atomic<size_t> allocationBytes(0);
+
+void countAllocation(std::size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocationBytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+size_t heapAllocations() {
+    return allocationCount.load(std::memory_order_relaxed);
+}
+size_t heapBytes() {
+    return allocationBytes.load(std::memory_order_relaxed);
+}
+#endif
+
+
+// Drives the timed loop of one benchmark run:
+//     while (state.keepRunning()) { ...one operation... }
+// Iterations run in batches that double in size until minTime has passed,
+// so the clock is read once per batch rather than once per operation.
+class BenchmarkState {
+private:
+    using Clock = std::chrono::steady_clock;
+    size_t range;
+    Clock::duration minTime;
+    size_t maxIterations = std::numeric_limits<size_t>::max();
+    size_t iterations = 0;
+    size_t batchLeft = 0;
+    size_t nextBatch = 1;
+    bool started = false;
+    // Totals while the clock runs, and where they stood when it last started
+    Clock::duration elapsed = Clock::duration::zero();
+    size_t allocations = 0;
+    size_t bytes = 0;
+    Clock::time_point startTime;
+    size_t startAllocations = 0;
+    size_t startBytes = 0;
+
+    void startClock() {
+        startAllocations = heapAllocations();
+        startBytes = heapBytes();
+        startTime = Clock::now();
+    }
+
+    void stopClock() {
+        elapsed += Clock::now() - startTime;
+        allocations += heapAllocations() - startAllocations;
+        bytes += heapBytes() - startBytes;
+    }
+
+public:
+    BenchmarkState(size_t range, Clock::duration minTime) : range(range), minTime(minTime) {}
+
+    // Returns true while there is another iteration to run
+    bool keepRunning() {
+        if (batchLeft > 0) {
+            batchLeft--;
+            iterations++;
+            return true;
+        }
+        if (started) {
+            stopClock();
+            if (elapsed >= minTime || iterations >= maxIterations) return false;
+        }
+        started = true;
+        size_t batch = std::min(nextBatch, maxIterations - iterations);
+        nextBatch *= 2;
+        batchLeft = batch - 1;
+        iterations++;
+        startClock();
+        return true;
+    }
+
+    // Keeps setup or cleanup inside the loop out of the results
+    void pauseTiming() {
+        stopClock();
+    }
+    void resumeTiming() {
+        startClock();
+    }
+
+    // Caps the run for operations that use something up (e.g. ids to delete)
+    void setMaxIterations(size_t count) {
+        maxIterations = std::max<size_t>(count, 1);
+    }
+
+    // Getters
+    size_t getRange() const {
+        return range;
+    }
+    size_t getIterations() const {
+        return iterations;
+    }
+    double nanosecondsPerOp() const {
+        return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+    }
+    double allocationsPerOp() const {
+        return static_cast<double>(allocations) / iterations;
+    }
+    double bytesPerOp() const {
+        return static_cast<double>(bytes) / iterations;
+    }
+};
+
+
+const Benchmark BENCHMARKS[] = {
+    {"load/text", benchLoadText},
+    {"load/binary", benchLoadBinary},
+    {"save/text", benchSaveText},
+    {"save/binary", benchSaveBinary},
+    {"add", benchAdd},
+    {"toggle", benchToggle},
+    {"edit", benchEdit},
+    {"delete", benchDelete},
+    {"view/page", benchViewPage},
+    {"view/all", benchViewAll},
+    {"find/substring", benchFindSubstring},
+    {"find/word-index", benchFindWordIndex},
+};
+
+// Task counts every benchmark runs at, unless --sizes says otherwise
+const std::vector<size_t> DEFAULT_SIZES = {1000, 100000, 10000000};
+
+// Each benchmark runs for at least this long (set with --min-time)
+std::chrono::milliseconds minTime(500);
+
+// How hard snapshots sync to disk (set with --durability).
+// None measures the task list, not the disk.
+Durability durability = Durability::None;
+
+// The snapshot load and save benchmarks work on, inside the scratch directory
+const std::string BENCH_TASKS_FILE = "tasks.txt";
+
+// view/page formats this many tasks, the app's default page size
+const size_t PAGE_ROWS = 20;
+
+// Random ids are drawn from a table this size (a power of two)
+const size_t LOOKUP_IDS = 1 << 16;
+
+// Every change grows the journal, and add and edit the store too, so
+// their runs stop after this many operations
+const size_t GROWTH_LIMIT = 1 << 20;
+
+// find cycles through these queries: common and rare words, a pair and a number
+const char* const FIND_QUERIES[] = {"report", "dentist", "quarterly report", "#42"};
+const size_t FIND_QUERY_COUNT = sizeof(FIND_QUERIES) / sizeof(FIND_QUERIES[0]);
+
+// Words synthetic descriptions are made of
+const char* const WORDS[] = {
+    "review", "write", "call", "fix", "plan", "email", "buy", "update", "draft", "send",
+    "quarterly", "report", "budget", "meeting", "groceries", "invoice", "design", "bug",
+    "release", "notes", "dentist", "team", "project", "slides", "backup", "server",
+};
+
+
+int main(int argc, char* argv[]) {
+    std::ios::sync_with_stdio(false);
+
+    std::string filter;
+    std::vector<size_t> sizes = DEFAULT_SIZES;
+    for (int i = 1; i < argc; i++) {
+        std::string option = argv[i];
+        size_t milliseconds = 0;
+        if (option == "--filter" && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (option == "--sizes" && i + 1 < argc) {
+            if (!parseSizes(argv[++i], sizes)) {
+                printBenchUsage(argv[0]);
+                return 1;
+            }
+        } else if (option == "--min-time" && i + 1 < argc) {
+            if (!parseCount(argv[++i], milliseconds)) {
+                printBenchUsage(argv[0]);
+                return 1;
+            }
+            minTime = std::chrono::milliseconds(milliseconds);
+        } else if (option == "--durability" && i + 1 < argc) {
+            if (!parseDurability(argv[++i], durability)) {
+                printBenchUsage(argv[0]);
+                return 1;
+            }
+        } else if (option == "--generate" && (i + 3 == argc || i + 4 == argc)) {
+            // Write a synthetic tasks file and exit
+            size_t count;
+            SnapshotFormat format = SnapshotFormat::Text;
+            if (!parseCount(argv[i + 1], count) ||
+                (i + 4 == argc && !parseSnapshotFormat(argv[i + 3], format))) {
+                printBenchUsage(argv[0]);
+                return 1;
+            }
+            if (!writeSyntheticSnapshot(argv[i + 2], count, format)) {
+                std::cerr << "Could not write " << argv[i + 2] << "\n";
+                return 1;
+            }
+            return 0;
+        } else {
+            printBenchUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    // Snapshots are written to tasks.txt in a scratch directory
+    std::error_code ec;
+    std::filesystem::path original = std::filesystem::current_path();
+    std::filesystem::path scratch = std::filesystem::temp_directory_path() /
+                                    ("todo_bench_" + std::to_string(std::random_device()()));
+    std::filesystem::create_directories(scratch, ec);
+    std::filesystem::current_path(scratch, ec);
+    if (ec) {
+        std::cerr << "Could not create " << scratch << "\n";
+        return 1;
+    }
+
+    std::printf("%-24s %14s %12s %12s %14s\n", "Benchmark", "ns/op", "Iterations", "allocs/op", "bytes/op");
+    std::printf("%s\n", std::string(80, '-').c_str());
+    for (size_t count : sizes) {
+        for (const Benchmark& benchmark : BENCHMARKS) {
+            std::string name = benchmark.name;
+            if (name.find(filter) == std::string::npos) continue;
+            runBenchmark(benchmark, count);
+        }
+    }
+
+    std::filesystem::current_path(original, ec);
+    std::filesystem::remove_all(scratch, ec);
+    return 0;
+}
+
+
+void runBenchmark(const Benchmark& benchmark, size_t count) {
+    /*
+    This function runs one benchmark at count tasks and prints its row.
+    */
+    // Start each run from a clean directory and a fresh id counter
+    std::error_code ec;
+    for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(".", ec))
+        std::filesystem::remove(entry.path(), ec);
+    Task::setNextId(1);
+
+    BenchmarkState state(count, minTime);
+    benchmark.function(state);
+
+    std::string name = std::string(benchmark.name) + "/" + std::to_string(count);
+    std::printf("%-24s %14.1f %12zu %12.3f %14.1f\n", name.c_str(), state.nanosecondsPerOp(),
+                state.getIterations(), state.allocationsPerOp(), state.bytesPerOp());
+    std::fflush(stdout);
+}
+
+
+void generateTasks(TaskStore& tasks, size_t count) {
+    /*
+    This function fills tasks with count synthetic tasks, ids 1 to count.
+    The same count always gives the same tasks. Descriptions run from two
+    to eight words, some with a number, and every third task is completed.
+    */
+    std::mt19937 rng(42);
+    std::string description;
+    tasks.reserve(tasks.size() + count);
+    for (size_t i = 1; i <= count; i++) {
+        description.clear();
+        size_t words = 2 + rng() % 7;
+        for (size_t w = 0; w < words; w++) {
+            if (w > 0) description += ' ';
+            description += WORDS[rng() % (sizeof(WORDS) / sizeof(WORDS[0]))];
+        }
+        if (rng() % 4 == 0) {
+            description += " #";
+            description += std::to_string(rng() % 1000);
+        }
+        tasks.add(Task(static_cast<int>(i), description, i % 3 == 0));
+    }
+    if (static_cast<int>(count) >= Task::getNextId()) Task::setNextId(static_cast<int>(count) + 1);
+}
+
+
+bool writeSyntheticSnapshot(const std::string& path, size_t count, SnapshotFormat format) {
+    /*
+    This function writes count synthetic tasks to a snapshot file at path.
+    */
+    TaskStore tasks;
+    generateTasks(tasks, count);
+    return writeSnapshot(tasks, path, format, durability);
+}
+
+
+void loadSyntheticList(TaskList& list, size_t count) {
+    /*
+    This function loads count synthetic tasks into list the way the app
+    starts up, from a snapshot in the scratch directory. Compaction is
+    turned off so a background rewrite of the snapshot does not land in
+    the middle of a timed run; the journal records themselves are still
+    built and committed.
+    */
+    writeSyntheticSnapshot(BENCH_TASKS_FILE, count, SnapshotFormat::Binary);
+    list.configure(durability, GROUP_COMMIT_WINDOW, GROUP_COMMIT_RECORDS);
+    list.setCompactionLimits(std::numeric_limits<size_t>::max(), std::numeric_limits<std::uintmax_t>::max());
+    list.load();
+}
+
+
+std::vector<int> randomIds(size_t count, size_t howMany) {
+    /*
+    This function returns howMany ids picked at random from 1 to count.
+    */
+    std::mt19937 rng(7);
+    std::vector<int> ids(howMany);
+    for (int& id : ids) id = static_cast<int>(1 + rng() % count);
+    return ids;
+}
+
+
+bool parseSizes(const std::string& text, std::vector<size_t>& sizes) {
+    /*
+    This function parses a comma-separated list of task counts into sizes.
+    */
+    sizes.clear();
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t comma = text.find(',', start);
+        if (comma == std::string::npos) comma = text.size();
+        size_t count;
+        if (!parseCount(text.substr(start, comma - start), count) || count == 0) return false;
+        sizes.push_back(count);
+        start = comma + 1;
+    }
+    return !sizes.empty();
+}
+
+
+void printBenchUsage(const char* program) {
+    /*
+    This function prints the command-line options.
+    */
+    std::cerr << "Usage: " << program << " [options]\n"
+              << "  --filter <text>                 run only benchmarks whose name contains text\n"
+              << "  --sizes <n,n,...>               task counts to run at (default 1000,100000,10000000)\n"
+              << "  --min-time <ms>                 run each benchmark at least this long (default 500)\n"
+              << "  --durability <none|data|full>   how saves sync to disk (default none)\n"
+              << "  --generate <count> <file> [text|binary]\n"
+              << "                                  write a synthetic tasks file and exit\n";
+}
+
+
+void benchLoad(BenchmarkState& state, SnapshotFormat format) {
+    /*
+    This function measures loading a snapshot of the given format.
+    */
+    writeSyntheticSnapshot(BENCH_TASKS_FILE, state.getRange(), format);
+    while (state.keepRunning()) {
+        std::unique_ptr<TaskList> list = std::make_unique<TaskList>(BENCH_TASKS_FILE);
+        list->configure(durability, GROUP_COMMIT_WINDOW, GROUP_COMMIT_RECORDS);
+        list->load();
+        state.pauseTiming();
+        list.reset(); // Freeing the list is not part of loading
+        state.resumeTiming();
+    }
+}
+
+void benchLoadText(BenchmarkState& state) {
+    benchLoad(state, SnapshotFormat::Text);
+}
+
+void benchLoadBinary(BenchmarkState& state) {
+    benchLoad(state, SnapshotFormat::Binary);
+}
+
+
+void benchSave(BenchmarkState& state, SnapshotFormat format) {
+    /*
+    This function measures saving every task as a snapshot of the given format.
+    */
+    // The list saves in the format it loaded
+    writeSyntheticSnapshot(BENCH_TASKS_FILE, state.getRange(), format);
+    TaskList list(BENCH_TASKS_FILE);
+    list.configure(durability, GROUP_COMMIT_WINDOW, GROUP_COMMIT_RECORDS);
+    list.load();
+    while (state.keepRunning()) list.save();
+}
+
+void benchSaveText(BenchmarkState& state) {
+    benchSave(state, SnapshotFormat::Text);
+}
+
+void benchSaveBinary(BenchmarkState& state) {
+    benchSave(state, SnapshotFormat::Binary);
+}
+
+
+void benchAdd(BenchmarkState& state) {
+    /*
+    This function measures adding a new task to the list.
+    */
+    TaskList list(BENCH_TASKS_FILE);
+    loadSyntheticList(list, state.getRange());
+    std::string description = "review the quarterly report #1";
+    state.setMaxIterations(GROWTH_LIMIT);
+    while (state.keepRunning()) list.add(description);
+}
+
+
+void benchToggle(BenchmarkState& state) {
+    /*
+    This function measures looking up a random id and flipping its completed flag.
+    */
+    TaskList list(BENCH_TASKS_FILE);
+    loadSyntheticList(list, state.getRange());
+    std::vector<int> ids = randomIds(state.getRange(), LOOKUP_IDS);
+    size_t next = 0;
+    state.setMaxIterations(GROWTH_LIMIT);
+    while (state.keepRunning()) list.toggle(ids[next++ & (LOOKUP_IDS - 1)]);
+}
+
+
+void benchEdit(BenchmarkState& state) {
+    /*
+    This function measures replacing the description of a random id.
+    */
+    TaskList list(BENCH_TASKS_FILE);
+    loadSyntheticList(list, state.getRange());
+    std::vector<int> ids = randomIds(state.getRange(), LOOKUP_IDS);
+    const std::string descriptions[] = {"send the invoice", "plan the release notes for the team"};
+    size_t next = 0;
+    state.setMaxIterations(GROWTH_LIMIT);
+    while (state.keepRunning()) {
+        list.edit(ids[next & (LOOKUP_IDS - 1)], descriptions[next & 1]);
+        next++;
+    }
+}
+
+
+void benchDelete(BenchmarkState& state) {
+    /*
+    This function measures removing tasks in random order, until none are left.
+    */
+    TaskList list(BENCH_TASKS_FILE);
+    loadSyntheticList(list, state.getRange());
+    std::vector<int> order(state.getRange());
+    for (size_t i = 0; i < order.size(); i++) order[i] = static_cast<int>(i + 1);
+    std::shuffle(order.begin(), order.end(), std::mt19937(7));
+    size_t next = 0;
+    state.setMaxIterations(std::min(order.size(), GROWTH_LIMIT));
+    while (state.keepRunning()) list.remove(order[next++]);
+}
+
+
+void benchViewPage(BenchmarkState& state) {
+    /*
+    This function measures formatting one page of the list, starting at a
+    random id, the way viewTasks does for every page it shows.
+    */
+    TaskStore tasks;
+    generateTasks(tasks, state.getRange());
+    std::vector<int> ids = randomIds(state.getRange(), LOOKUP_IDS);
+    size_t next = 0;
+    std::string buffer;
+    while (state.keepRunning()) {
+        buffer.clear();
+        TaskStore::const_iterator it = tasks.findPosition(ids[next++ & (LOOKUP_IDS - 1)]);
+        renderTaskWindow(it, tasks.end(), PAGE_ROWS, buffer);
+    }
+}
+
+
+void benchViewAll(BenchmarkState& state) {
+    /*
+    This function measures formatting every task in the list.
+    */
+    TaskStore tasks;
+    generateTasks(tasks, state.getRange());
+    std::string buffer;
+    while (state.keepRunning()) {
+        buffer.clear();
+        TaskStore::const_iterator it = tasks.begin();
+        renderTaskWindow(it, tasks.end(), tasks.size(), buffer);
+    }
+}
+
+
+void benchFind(BenchmarkState& state, bool wordIndex) {
+    /*
+    This function measures searching every task for one of FIND_QUERIES.
+    The substring matcher scans all the description text each time; the
+    word index intersects posting lists, so it is built before the run.
+    */
+    TaskList list(BENCH_TASKS_FILE);
+    list.setWordIndex(wordIndex);
+    loadSyntheticList(list, state.getRange());
+    std::vector<int> matches;
+    list.find(FIND_QUERIES[0], matches);
+    size_t next = 0;
+    while (state.keepRunning()) list.find(FIND_QUERIES[next++ % FIND_QUERY_COUNT], matches);
+}
+
+void benchFindSubstring(BenchmarkState& state) {
+    benchFind(state, false);
+}
+
+void benchFindWordIndex(BenchmarkState& state) {
+    benchFind(state, true);
+}
@@ -0,0 +1,782 @@
+/*
+============================================
+ TODO CLI Tests
+============================================
+
+ Description:
+   Checks the parts of the task engine that
+   have more than one implementation, or
+   whose bugs would only show on a large or
+   damaged file:
+     - the SIMD kernels against their scalar
+       versions
+     - text <-> binary snapshot round trips,
+       and rejection of a truncated snapshot
+     - task row formatting, including an
+       empty description
+     - TaskList changes over several sessions
+       against a model, with compaction and
+       the journal states a crash during it
+       leaves behind
+     - word-index search against a brute
+       force scan, rebuilt and loaded from
+       its file
+   TaskList.cpp is compiled into this file so
+   the engine's internal helpers can be
+   called directly. Files are written to a
+   scratch directory removed afterwards.
+
+ Compilation:
+   built with the app by CMake and run by
+   ctest, or:
+   clang++ -std=c++17 -O2 -pthread -I. -o todo_tests tests/todo_tests.cpp
+
+ Usage:
+   ./todo_tests [--filter <text>]
+
+============================================
+*/
+
+#include "TaskList.cpp"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <cstdio>
+#include <random>
+#include <map>
+#include <utility>
+
+using TestFunction = void (*)();
+
+// What the task list should hold: description and completed flag by id
+using TaskModel = std::map<int, std::pair<std::string, bool>>;
+
+struct Test {
+    const char* name;
+    TestFunction function;
+};
+
+void expect(bool condition, const std::string& what);
+std::string randomText(std::mt19937& rng, size_t size, const char* alphabet);
+void fillTasks(TaskStore& tasks, std::mt19937& rng, size_t count);
+bool sameTasks(const TaskStore& a, const TaskStore& b);
+bool matchesModel(const TaskStore& tasks, const TaskModel& model);
+void applyRandomChanges(TaskList& list, TaskModel& model, std::mt19937& rng, size_t count);
+void bruteForceFind(const TaskStore& tasks, std::string_view query, std::vector<int>& matches);
+void expectIndexMatches(const WordIndex& index, const TaskStore& tasks, const std::string& when);
+uint64_t skipCount(const WordIndex& index);
+void testDelimiterScan();
+void testSubstringSearch();
+void testLiveBitCount();
+void testSnapshotRoundTrip();
+void testTruncatedSnapshot();
+void testRenderRows();
+void testOneLineDescriptions();
+void testJournalWriteFailure();
+void testCompaction();
+void testWordIndexRebuilt();
+void testWordIndexLoaded();
+void testWordIndexSkips();
+void testWordIndexDamaged();
+
+
+// Random text is drawn from a small alphabet so delimiters and matches are common
+const char* const SCAN_ALPHABET = "ab|\n c";
+const char* const SEARCH_ALPHABET = "abcab";
+// Few words, so every posting list runs over several skip blocks
+const char* const WORDS[] = {"milk", "eggs", "Bread", "call", "mom", "pay", "rent", "fix"};
+const size_t WORD_COUNT = sizeof(WORDS) / sizeof(WORDS[0]);
+const char* const QUERIES[] = {"milk", "bread", "call mom", "pay rent fix", "eggs milk bread", "tea", ""};
+
+const Test TESTS[] = {
+    {"kernels/delimiter-scan", testDelimiterScan},
+    {"kernels/substring-search", testSubstringSearch},
+    {"kernels/live-bit-count", testLiveBitCount},
+    {"snapshot/round-trip", testSnapshotRoundTrip},
+    {"snapshot/truncated", testTruncatedSnapshot},
+    {"render/rows", testRenderRows},
+    {"task-list/newlines", testOneLineDescriptions},
+    {"task-list/journal-failure", testJournalWriteFailure},
+    {"task-list/compaction", testCompaction},
+    {"word-index/rebuilt", testWordIndexRebuilt},
+    {"word-index/loaded", testWordIndexLoaded},
+    {"word-index/skips", testWordIndexSkips},
+    {"word-index/damaged", testWordIndexDamaged},
+};
+
+// Failures of the test being run
+size_t failures = 0;
+
+
+int main(int argc, char* argv[]) {
+    std::string filter;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--filter" && i + 1 < argc) {
+            filter = argv[++i];
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--filter <text>]\n";
+            return 1;
+        }
+    }
+
+    // Snapshots and index files are written in a scratch directory
+    std::error_code ec;
+    std::filesystem::path original = std::filesystem::current_path();
+    std::filesystem::path scratch = std::filesystem::temp_directory_path() /
+                                    ("todo_tests_" + std::to_string(std::random_device()()));
+    std::filesystem::create_directories(scratch, ec);
+    std::filesystem::current_path(scratch, ec);
+    if (ec) {
+        std::cerr << "Could not create " << scratch << "\n";
+        return 1;
+    }
+
+    size_t failed = 0;
+    for (const Test& test : TESTS) {
+        if (std::string(test.name).find(filter) == std::string::npos) continue;
+        failures = 0;
+        test.function();
+        std::printf("%-28s %s\n", test.name, failures == 0 ? "ok" : "FAILED");
+        if (failures != 0) failed++;
+    }
+
+    std::filesystem::current_path(original, ec);
+    std::filesystem::remove_all(scratch, ec);
+    return failed == 0 ? 0 : 1;
+}
+
+
+void expect(bool condition, const std::string& what) {
+    /*
+    This function reports a failed check; the test goes on so every
+    failure in it is shown.
+    */
+    if (condition) return;
+    failures++;
+    std::cerr << "  failed: " << what << "\n";
+}
+
+
+std::string randomText(std::mt19937& rng, size_t size, const char* alphabet) {
+    /*
+    This function returns size random bytes drawn from alphabet.
+    */
+    size_t letters = std::strlen(alphabet);
+    std::string text(size, ' ');
+    for (char& c : text) c = alphabet[rng() % letters];
+    return text;
+}
+
+
+void fillTasks(TaskStore& tasks, std::mt19937& rng, size_t count) {
+    /*
+    This function adds count tasks with ids 1..count, each described by a
+    few random words and completed at random.
+    */
+    for (size_t i = 1; i <= count; i++) {
+        std::string description;
+        size_t words = 1 + rng() % 4;
+        for (size_t w = 0; w < words; w++) {
+            if (w > 0) description += rng() % 2 ? " " : ", ";
+            description += WORDS[rng() % WORD_COUNT];
+        }
+        tasks.add(Task(static_cast<int>(i), description, rng() % 3 == 0));
+    }
+}
+
+
+bool sameTasks(const TaskStore& a, const TaskStore& b) {
+    /*
+    This function checks that two stores hold the same tasks in the same order.
+    */
+    if (a.size() != b.size() || a.getHighestId() != b.getHighestId()) return false;
+    TaskStore::const_iterator other = b.begin();
+    for (const Task& task : a) {
+        Task copy = *other;
+        if (task.getId() != copy.getId() || task.getDescription() != copy.getDescription() ||
+            task.isCompleted() != copy.isCompleted()) return false;
+        ++other;
+    }
+    return true;
+}
+
+
+bool matchesModel(const TaskStore& tasks, const TaskModel& model) {
+    /*
+    This function checks that a store holds exactly the tasks of model.
+    Replayed adds may land out of id order, so the order is not compared.
+    */
+    if (tasks.size() != model.size()) return false;
+    for (const Task& task : tasks) {
+        auto it = model.find(task.getId());
+        if (it == model.end() || it->second.first != task.getDescription() ||
+            it->second.second != task.isCompleted()) return false;
+    }
+    return true;
+}
+
+
+void applyRandomChanges(TaskList& list, TaskModel& model, std::mt19937& rng, size_t count) {
+    /*
+    This function makes count random adds, toggles, edits and deletes to
+    both list and model.
+    */
+    for (size_t i = 0; i < count; i++) {
+        unsigned op = rng() % 8;
+        if (op < 3 || model.empty()) {
+            std::string description = std::string(WORDS[rng() % WORD_COUNT]) + " " + std::to_string(i);
+            int id = list.add(description);
+            model[id] = {description, false};
+            continue;
+        }
+        auto it = model.begin();
+        std::advance(it, rng() % model.size());
+        int id = it->first;
+        if (op < 5) {
+            expect(list.toggle(id), "toggle of a task that exists");
+            it->second.second = !it->second.second;
+        } else if (op < 7) {
+            std::string description = std::string(WORDS[rng() % WORD_COUNT]) + " | edited " + std::to_string(i);
+            expect(list.edit(id, description), "edit of a task that exists");
+            it->second.first = description;
+        } else {
+            expect(list.remove(id), "delete of a task that exists");
+            model.erase(it);
+        }
+    }
+}
+
+
+void bruteForceFind(const TaskStore& tasks, std::string_view query, std::vector<int>& matches) {
+    /*
+    This function finds the tasks containing every word of query by
+    tokenizing each description, in ascending id order like WordIndex::find.
+    */
+    matches.clear();
+    std::vector<std::string> queryWords;
+    WordIndex::tokenize(query, queryWords);
+    if (queryWords.empty()) return;
+    std::vector<std::string> words;
+    for (const Task& task : tasks) {
+        WordIndex::tokenize(task.getDescription(), words);
+        bool all = true;
+        for (const std::string& word : queryWords) {
+            all = all && std::binary_search(words.begin(), words.end(), word);
+        }
+        if (all) matches.push_back(task.getId());
+    }
+    std::sort(matches.begin(), matches.end());
+}
+
+
+void expectIndexMatches(const WordIndex& index, const TaskStore& tasks, const std::string& when) {
+    /*
+    This function checks every query against the brute force scan.
+    */
+    std::vector<int> found;
+    std::vector<int> expected;
+    for (const char* query : QUERIES) {
+        index.find(query, found);
+        bruteForceFind(tasks, query, expected);
+        expect(found == expected, when + ": \"" + query + "\" found " + std::to_string(found.size()) +
+                                      " tasks, expected " + std::to_string(expected.size()));
+    }
+}
+
+
+uint64_t skipCount(const WordIndex& index) {
+    /*
+    This function returns how many skip entries the index has in all,
+    as recorded in the header of its file layout.
+    */
+    std::string buffer;
+    index.serialize(0, buffer);
+    WordIndexHeader header;
+    std::memcpy(&header, buffer.data(), sizeof(header));
+    return header.skipCount;
+}
+
+
+void testDelimiterScan() {
+    /*
+    This function checks the delimiter scanners against the scalar one at
+    every size up to a few vectors and at every alignment within one.
+    */
+    std::mt19937 rng(1);
+    std::string buffer = randomText(rng, 4096 + 64, SCAN_ALPHABET);
+    std::vector<uint32_t> expected(buffer.size());
+    std::vector<uint32_t> found(buffer.size());
+    for (size_t start = 0; start < 32; start++) {
+        for (size_t size = 0; size <= 200; size++) {
+            const char* data = buffer.data() + start;
+            size_t count = scanDelimitersScalar(data, size, expected.data());
+#if TODO_X86
+            std::string where = " at " + std::to_string(start) + "+" + std::to_string(size);
+            size_t sse2 = scanDelimitersSse2(data, size, found.data());
+            expect(sse2 == count && std::equal(expected.begin(), expected.begin() + count, found.begin()),
+                   "SSE2 scan" + where);
+            if (cpuHasAvx2()) {
+                size_t avx2 = scanDelimitersAvx2(data, size, found.data());
+                expect(avx2 == count && std::equal(expected.begin(), expected.begin() + count, found.begin()),
+                       "AVX2 scan" + where);
+            }
+#endif
+            size_t picked = scanDelimiters(data, size, found.data());
+            expect(picked == count && std::equal(expected.begin(), expected.begin() + count, found.begin()),
+                   "picked scan at " + std::to_string(start) + "+" + std::to_string(size));
+        }
+    }
+
+    // A whole block, as the snapshot parser scans it
+    std::string block = randomText(rng, SCAN_BLOCK_SIZE, SCAN_ALPHABET);
+    expected.resize(block.size());
+    found.resize(block.size());
+    size_t count = scanDelimitersScalar(block.data(), block.size(), expected.data());
+    size_t picked = scanDelimiters(block.data(), block.size(), found.data());
+    expect(picked == count && std::equal(expected.begin(), expected.begin() + count, found.begin()),
+           "picked scan of a full block");
+}
+
+
+void testSubstringSearch() {
+    /*
+    This function checks the substring finders against the scalar one for
+    needles of every length up to two vectors, found and not found, near
+    both ends of the text.
+    */
+    std::mt19937 rng(2);
+    for (size_t round = 0; round < 3000; round++) {
+        size_t size = rng() % 160;
+        std::string text = randomText(rng, size, SEARCH_ALPHABET);
+        size_t needleSize = rng() % 70;
+        std::string needle;
+        if (needleSize <= size && rng() % 2) {
+            // Cut from the text, so it is found
+            needle = text.substr(rng() % (size - needleSize + 1), needleSize);
+        } else {
+            needle = randomText(rng, needleSize, SEARCH_ALPHABET);
+        }
+        size_t expected = findSubstringScalar(text.data(), size, needle.data(), needleSize);
+        std::string where = " for a " + std::to_string(needleSize) + "-byte needle in " +
+                            std::to_string(size) + " bytes";
+#if TODO_X86
+        expect(findSubstringSse2(text.data(), size, needle.data(), needleSize) == expected, "SSE2 search" + where);
+        if (cpuHasAvx2()) {
+            expect(findSubstringAvx2(text.data(), size, needle.data(), needleSize) == expected,
+                   "AVX2 search" + where);
+        }
+#endif
+        expect(findSubstring(text.data(), size, needle.data(), needleSize) == expected, "picked search" + where);
+    }
+}
+
+
+void testLiveBitCount() {
+    /*
+    This function checks the bit counters against the scalar one on sparse,
+    dense and random words.
+    */
+    std::mt19937_64 rng(3);
+    const size_t words = 257;
+    std::vector<uint64_t> completed(words);
+    std::vector<uint64_t> dead(words);
+    for (size_t round = 0; round < 50; round++) {
+        for (size_t i = 0; i < words; i++) {
+            switch (round % 3) {
+            case 0: completed[i] = rng(); dead[i] = rng(); break;
+            case 1: completed[i] = ~uint64_t(0); dead[i] = rng() & rng() & rng(); break;
+            default: completed[i] = uint64_t(1) << (rng() % 64); dead[i] = 0; break;
+            }
+        }
+        for (size_t count : {size_t(0), size_t(1), size_t(7), words}) {
+            size_t expected = countLiveBitsScalar(completed.data(), dead.data(), count);
+            std::string where = " over " + std::to_string(count) + " words";
+#if TODO_X86
+            if (cpuHasPopcnt()) {
+                expect(countLiveBitsPopcnt(completed.data(), dead.data(), count) == expected, "POPCNT count" + where);
+            }
+#endif
+            expect(countLiveBits(completed.data(), dead.data(), count) == expected, "picked count" + where);
+        }
+    }
+}
+
+
+void testSnapshotRoundTrip() {
+    /*
+    This function writes tasks as text, converts them to binary and back,
+    and checks that every step reads back the same tasks in the right format.
+    */
+    std::mt19937 rng(4);
+    TaskStore tasks;
+    fillTasks(tasks, rng, 5000);
+    tasks.add(Task(5001, "", false));
+    tasks.add(Task(5002, "a description | with a pipe", true));
+    tasks.add(Task(7000, "an id after a gap", false));
+    expect(writeSnapshot(tasks, "tasks.txt", SnapshotFormat::Text, Durability::None), "text snapshot written");
+
+    expect(convertSnapshot(SnapshotFormat::Binary, "tasks.txt", "tasks.bin", Durability::None),
+           "text converted to binary");
+    TaskStore binary;
+    SnapshotFormat format = SnapshotFormat::Text;
+    expect(readSnapshot(binary, "tasks.bin", format), "binary snapshot read");
+    expect(format == SnapshotFormat::Binary, "binary snapshot detected");
+    expect(sameTasks(tasks, binary), "binary snapshot holds the tasks");
+
+    expect(convertSnapshot(SnapshotFormat::Text, "tasks.bin", "tasks.back.txt", Durability::None),
+           "binary converted to text");
+    TaskStore text;
+    expect(readSnapshot(text, "tasks.back.txt", format), "text snapshot read");
+    expect(format == SnapshotFormat::Text, "text snapshot detected");
+    expect(sameTasks(tasks, text), "text snapshot holds the tasks");
+}
+
+
+void testTruncatedSnapshot() {
+    /*
+    This function cuts a binary snapshot short at several points and checks
+    that each one is rejected whole and cannot be converted.
+    */
+    std::mt19937 rng(5);
+    TaskStore tasks;
+    fillTasks(tasks, rng, 1000);
+    expect(writeSnapshot(tasks, "tasks.bin", SnapshotFormat::Binary, Durability::None), "binary snapshot written");
+    std::error_code ec;
+    std::uintmax_t size = std::filesystem::file_size("tasks.bin", ec);
+    expect(!ec && size > sizeof(BinarySnapshotHeader), "binary snapshot has columns");
+    if (ec) return;
+
+    for (std::uintmax_t cut : {size - 1, size / 2, std::uintmax_t(sizeof(BinarySnapshotHeader)),
+                               std::uintmax_t(sizeof(BINARY_MAGIC) + 1)}) {
+        std::filesystem::copy_file("tasks.bin", "truncated.bin", std::filesystem::copy_options::overwrite_existing, ec);
+        std::filesystem::resize_file("truncated.bin", cut, ec);
+        expect(!ec, "snapshot truncated");
+
+        std::string where = " cut to " + std::to_string(cut) + " of " + std::to_string(size) + " bytes";
+        TaskStore damaged;
+        SnapshotFormat format = SnapshotFormat::Text;
+        expect(!readSnapshot(damaged, "truncated.bin", format), "snapshot rejected" + where);
+        expect(damaged.empty(), "no tasks read" + where);
+        expect(!convertSnapshot(SnapshotFormat::Text, "truncated.bin", "converted.txt", Durability::None),
+               "conversion refused" + where);
+    }
+}
+
+
+void testRenderRows() {
+    /*
+    This function formats a window of tasks, including one with an empty
+    description and one with the widest id, and checks every line.
+    */
+    TaskStore tasks;
+    tasks.add(Task(1, "Buy milk", true));
+    tasks.add(Task(2, "", false));
+    tasks.add(Task(INT_MAX, "last", false));
+    std::string out = "> ";
+    TaskStore::const_iterator it = tasks.begin();
+    expect(renderTaskWindow(it, tasks.end(), 10, out) == 3, "every task shown");
+    expect(it == tasks.end(), "window moved past the tasks");
+    expect(out == "> [x] 1: Buy milk\n[ ] 2: \n[ ] 2147483647: last\n", "rows formatted: " + out);
+
+    // A window stops at count
+    out.clear();
+    it = tasks.begin();
+    expect(renderTaskWindow(it, tasks.end(), 2, out) == 2, "window of two shown");
+    expect(out == "[x] 1: Buy milk\n[ ] 2: \n", "window of two formatted: " + out);
+}
+
+
+void testOneLineDescriptions() {
+    /*
+    This function checks that a description with a newline is refused by
+    add and edit, so it never reaches the journal, and that the list
+    reloads as it was.
+    */
+    {
+        TaskList list("lines.txt");
+        list.configure(Durability::None, std::chrono::milliseconds(0), 1);
+        expect(list.load(), "empty list loaded");
+        int id = list.add("Buy milk");
+        expect(id > 0, "one line added");
+        expect(list.add("Buy milk\nand eggs") == -1, "two lines refused by add");
+        expect(!list.edit(id, "Buy oat milk\n"), "two lines refused by edit");
+        expect(list.getTasks().size() == 1, "nothing added by a refused add");
+    }
+    TaskList reloaded("lines.txt");
+    expect(reloaded.load(), "list reloaded");
+    const TaskStore& tasks = reloaded.getTasks();
+    expect(tasks.size() == 1 && (*tasks.begin()).getDescription() == "Buy milk", "list reloaded as it was");
+}
+
+
+void testJournalWriteFailure() {
+    /*
+    This function points the journal at a full disk and checks close()
+    reports the lost records, and that a save clears the failure.
+    */
+#if defined(__linux__)
+    std::error_code ec;
+    std::filesystem::create_symlink("/dev/full", "full.journal", ec);
+    expect(!ec, "journal linked to /dev/full");
+    if (ec) return;
+    {
+        TaskList list("full.txt");
+        list.configure(Durability::None, std::chrono::milliseconds(0), 1);
+        expect(list.load(), "empty list loaded");
+        list.add("Buy milk");
+        list.add("Call mom");
+        expect(!list.close(), "failed journal write reported");
+        expect(!list.close(), "failure still reported");
+    }
+    {
+        TaskList list("full.txt");
+        list.configure(Durability::None, std::chrono::milliseconds(0), 1);
+        expect(list.load(), "empty list loaded again");
+        list.add("Buy milk");
+        expect(list.save(), "snapshot saved");
+        expect(list.close(), "save clears the failure");
+    }
+    std::filesystem::remove("full.journal", ec);
+#endif
+    TaskList list("journal.txt");
+    list.configure(Durability::None, std::chrono::milliseconds(0), 1);
+    expect(list.load(), "list loaded");
+    list.add("Buy milk");
+    expect(list.close(), "journal written");
+}
+
+
+void testWordIndexRebuilt() {
+    /*
+    This function checks a freshly built index, then again after edits and
+    deletes rewrite blocks in the middle of the lists and new tasks go on the end.
+    */
+    std::mt19937 rng(6);
+    TaskStore tasks;
+    fillTasks(tasks, rng, 3000);
+    WordIndex index;
+    index.build(tasks);
+    expectIndexMatches(index, tasks, "built");
+
+    for (size_t i = 0; i < 500; i++) {
+        int id = 1 + static_cast<int>(rng() % 3000);
+        if (!tasks.contains(id)) continue;
+        std::string old(tasks.getDescription(id));
+        index.remove(id, old);
+        if (rng() % 2) {
+            tasks.remove(id);
+        } else {
+            std::string description = std::string(WORDS[rng() % WORD_COUNT]) + " " + WORDS[rng() % WORD_COUNT];
+            tasks.setDescription(id, description);
+            index.add(id, description);
+        }
+    }
+    for (int id = 3001; id <= 3200; id++) {
+        std::string description = WORDS[rng() % WORD_COUNT];
+        tasks.add(Task(id, description, false));
+        index.add(id, description);
+    }
+    expectIndexMatches(index, tasks, "after changes");
+}
+
+
+void testWordIndexLoaded() {
+    /*
+    This function writes an index to its file, loads it back and checks it,
+    then checks changes layered over the loaded file and a reload of those.
+    A file written for other tasks must not load.
+    */
+    std::mt19937 rng(7);
+    TaskStore tasks;
+    fillTasks(tasks, rng, 3000);
+    WordIndex built;
+    built.build(tasks);
+    std::string buffer;
+    built.serialize(contentChecksum(tasks), buffer);
+    expect(replaceFile("tasks.index", buffer, Durability::None), "index file written");
+
+    WordIndex index;
+    expect(!index.load("tasks.index", contentChecksum(tasks) + 1), "index for other tasks refused");
+    expect(index.load("tasks.index", contentChecksum(tasks)), "index file loaded");
+    expectIndexMatches(index, tasks, "loaded");
+
+    // Changes go into memory on top of the mapped lists
+    for (size_t i = 0; i < 300; i++) {
+        int id = 1 + static_cast<int>(rng() % 3000);
+        if (!tasks.contains(id)) continue;
+        std::string old(tasks.getDescription(id));
+        index.remove(id, old);
+        if (rng() % 2) {
+            tasks.remove(id);
+        } else {
+            std::string description = WORDS[rng() % WORD_COUNT];
+            tasks.setDescription(id, description);
+            index.add(id, description);
+        }
+    }
+    // Every task with this word goes, so its mapped list must be hidden
+    std::vector<int> ids;
+    index.find("rent", ids);
+    for (int id : ids) {
+        index.remove(id, tasks.getDescription(id));
+        tasks.setDescription(id, "done");
+        index.add(id, "done");
+    }
+    expectIndexMatches(index, tasks, "loaded and changed");
+
+    buffer.clear();
+    index.serialize(contentChecksum(tasks), buffer);
+    expect(replaceFile("tasks.index", buffer, Durability::None), "changed index file written");
+    WordIndex reloaded;
+    expect(reloaded.load("tasks.index", contentChecksum(tasks)), "changed index file loaded");
+    expectIndexMatches(reloaded, tasks, "reloaded");
+}
+
+
+void testWordIndexSkips() {
+    /*
+    This function inserts an older id into a full last block and then
+    appends many more, and checks the list is still split into blocks
+    like one built in order, so lookups can skip over them.
+    */
+    WordIndex index;
+    for (int id = 1; id <= 65; id++) {
+        if (id != 10) index.add(id, "milk");
+    }
+    index.add(10, "milk"); // The last block now holds one over the interval
+    for (int id = 66; id <= 20000; id++) index.add(id, "milk");
+
+    WordIndex inOrder;
+    for (int id = 1; id <= 20000; id++) inOrder.add(id, "milk");
+    expect(skipCount(index) == skipCount(inOrder),
+           std::to_string(skipCount(index)) + " skip entries after an older id, " +
+           std::to_string(skipCount(inOrder)) + " in order");
+
+    std::vector<int> found;
+    index.find("milk", found);
+    expect(found.size() == 20000 && found.front() == 1 && found.back() == 20000, "every id found");
+}
+
+
+void testWordIndexDamaged() {
+    /*
+    This function damages one skip entry at a time in an index file written
+    for the right tasks, and checks the word it belongs to is treated as
+    missing while the other words still match and can still be edited.
+    */
+    std::mt19937 rng(8);
+    TaskStore tasks;
+    fillTasks(tasks, rng, 3000);
+    WordIndex built;
+    built.build(tasks);
+    std::string buffer;
+    built.serialize(contentChecksum(tasks), buffer);
+    WordIndexHeader header;
+    std::memcpy(&header, buffer.data(), sizeof(header));
+    // The first word is "bread", and its skips come first
+    size_t skips = sizeof(header) + header.wordCount * sizeof(WordIndexEntry);
+
+    struct Damage {
+        const char* name;
+        size_t skip;
+        size_t field;  // Byte offset within the skip entry
+        int64_t value;
+    };
+    const Damage damages[] = {
+        {"offset past the list", 1, offsetof(WordIndex::Skip, offset), int64_t(1) << 40},
+        {"offset going back", 2, offsetof(WordIndex::Skip, offset), 1},
+        {"previous id going back", 3, offsetof(WordIndex::Skip, previousId), 0},
+        {"first block not at 0", 0, offsetof(WordIndex::Skip, offset), 3},
+    };
+    for (const Damage& damage : damages) {
+        std::string damaged = buffer;
+        std::memcpy(&damaged[skips + damage.skip * sizeof(WordIndex::Skip) + damage.field], &damage.value,
+                    sizeof(damage.value));
+        expect(replaceFile("tasks.index", damaged, Durability::None), "index file written");
+        std::string where = std::string(" with a skip ") + damage.name;
+
+        WordIndex index;
+        expect(index.load("tasks.index", contentChecksum(tasks)), "index file loaded" + where);
+        std::vector<int> found;
+        index.find("bread", found);
+        expect(found.empty(), "damaged word missing" + where);
+        index.find("milk", found);
+        std::vector<int> expected;
+        bruteForceFind(tasks, "milk", expected);
+        expect(found == expected, "other words found" + where);
+
+        // Edits must not write through the damaged skips
+        for (int id = 1; id <= 20; id++) index.remove(id, tasks.getDescription(id));
+        index.add(5, "bread milk");
+        index.find("bread", found);
+        expect(found == std::vector<int>{5}, "damaged word rebuilt by an edit" + where);
+    }
+}
+
+
+void testCompaction() {
+    /*
+    This function makes changes over several sessions with compaction
+    starting every few records, and checks each reload against a model.
+    Between sessions it leaves the two states a crash during compaction
+    can: a journal rotated to compactingFile that was never folded in,
+    and one folded into the snapshot but not yet removed.
+    */
+    const std::uintmax_t never = std::numeric_limits<std::uintmax_t>::max();
+    const std::string snapshot = "compact.txt";
+    const std::string journal = "compact.journal";
+    const std::string compacting = "compact.journal.compacting";
+    std::mt19937 rng(9);
+    TaskModel model;
+    std::error_code ec;
+
+    for (int session = 0; session < 6; session++) {
+        std::string when = "session " + std::to_string(session);
+        {
+            TaskList list(snapshot);
+            list.configure(Durability::None, std::chrono::milliseconds(0), 1);
+            // Session 2 leaves the rotated journal of session 1 in place while
+            // a new journal grows, so the next load replays both in order
+            list.setCompactionLimits(session == 2 ? std::numeric_limits<size_t>::max() : 40, never);
+            expect(list.load(), when + ": loaded");
+            expect(matchesModel(list.getTasks(), model), when + ": reloaded tasks match");
+            applyRandomChanges(list, model, rng, 300);
+            expect(matchesModel(list.getTasks(), model), when + ": tasks in memory match");
+            expect(list.close(), when + ": journal written");
+        }
+        // Every compaction has finished and removed its journal
+        expect(std::filesystem::exists(compacting, ec) == (session == 2),
+               when + (session == 2 ? ": rotated journal kept" : ": no compacting journal left"));
+
+        if (session == 1) {
+            // Crash after the rotation: the journal was never folded in
+            std::filesystem::rename(journal, compacting, ec);
+            expect(!ec, when + ": journal rotated");
+        } else if (session == 3) {
+            // Crash after the new snapshot was renamed in, before the
+            // compacting journal was removed: it is replayed a second time
+            std::filesystem::rename(journal, compacting, ec);
+            expect(!ec, when + ": journal rotated");
+            TaskStore folded;
+            SnapshotFormat format = SnapshotFormat::Text;
+            expect(readSnapshot(folded, snapshot, format), when + ": snapshot read");
+            replayJournal(folded, compacting);
+            expect(matchesModel(folded, model), when + ": folded tasks match");
+            expect(writeSnapshot(folded, snapshot, format, Durability::None), when + ": snapshot written");
+        }
+    }
+
+    // A save folds everything into the snapshot and empties the journal
+    TaskList list(snapshot);
+    list.configure(Durability::None, std::chrono::milliseconds(0), 1);
+    expect(list.load(), "last session loaded");
+    expect(matchesModel(list.getTasks(), model), "last session tasks match");
+    expect(list.save(), "saved");
+    expect(std::filesystem::file_size(journal, ec) == 0, "journal emptied by the save");
+    TaskStore saved;
+    SnapshotFormat format = SnapshotFormat::Text;
+    expect(readSnapshot(saved, snapshot, format) && matchesModel(saved, model), "snapshot holds every task");
+}